@@ -0,0 +1,111 @@
+#ifndef assembly_h
+#define assembly_h
+
+#include <Eigen/Sparse>
+#include <vector>
+#include <algorithm>
+#include "types.h"
+
+typedef Eigen::SparseMatrix<float> SparseMatrixf;
+typedef Eigen::Triplet<double> T;
+
+/**
+ * Assembles 12x12 matrices of individual tetrahedra into a global 3nx3n sparse matrix.
+ * The sparsity pattern is computed once from tetrahedra indices, after that
+ * element matrices are only added to the values of the compressed storage.
+ * Element matrices may be of a lower precision than Scalar, they are converted entry by entry.
+ */
+template<typename Scalar>
+class SparseAssembler {
+
+private:
+    // Global matrix with a fixed sparsity pattern.
+    Eigen::SparseMatrix<Scalar> matrix;
+    // Positions of element matrix entries in the values array of the global matrix.
+    // Entry (j,k) of i-th tetrahedron goes to scatterMap[144*i + 12*j + k].
+    std::vector<int> scatterMap;
+
+public:
+    SparseAssembler() = default;
+
+    template<typename Element>
+    SparseAssembler(unsigned long n, const AlignedVector<Element> &elements) {
+        long n_tet = elements.size();
+
+        // Every tetrahedron couples all 12 coordinates of its vertices.
+        std::vector<T> tripletList;
+        tripletList.reserve(144*n_tet);
+        for (int i = 0; i<n_tet; i++) {
+            for (int j = 0; j<12; j++) {
+                for (int k = 0; k<12; k++) {
+                    tripletList.push_back(T(3*elements[i].indices[j/3] + j%3,
+                                            3*elements[i].indices[k/3] + k%3,
+                                            0));
+                }
+            }
+        }
+        matrix = Eigen::SparseMatrix<Scalar>(3*n, 3*n);
+        matrix.setFromTriplets(tripletList.begin(), tripletList.end());
+        matrix.makeCompressed();
+
+        // Looking up where every element entry lives in the compressed storage.
+        const int *outer = matrix.outerIndexPtr();
+        const int *inner = matrix.innerIndexPtr();
+        scatterMap.resize(144*n_tet);
+        for (int i = 0; i<n_tet; i++) {
+            for (int j = 0; j<12; j++) {
+                for (int k = 0; k<12; k++) {
+                    int row = 3*elements[i].indices[j/3] + j%3;
+                    int col = 3*elements[i].indices[k/3] + k%3;
+                    const int *entry = std::lower_bound(inner + outer[col], inner + outer[col + 1], row);
+                    scatterMap[144*i + 12*j + k] = (int)(entry - inner);
+                }
+            }
+        }
+    }
+
+    // Zeroes the values, keeping the sparsity pattern.
+    void setZero() {
+        matrix.coeffs().setZero();
+    }
+
+    // Adds a 12x12 matrix of i-th tetrahedron to the global matrix.
+    template<typename Derived>
+    void addElement(int i, const Eigen::MatrixBase<Derived> &K_i) {
+        addElement(i, K_i, matrix.valuePtr());
+    }
+
+    // Adds a 12x12 matrix of i-th tetrahedron to a separate array laid out like the values of the global matrix.
+    template<typename Derived>
+    void addElement(int i, const Eigen::MatrixBase<Derived> &K_i, Scalar *values) const {
+        const int *slots = &scatterMap[144*i];
+        for (int j = 0; j<12; j++) {
+            for (int k = 0; k<12; k++) {
+                values[slots[12*j + k]] += K_i(j,k);
+            }
+        }
+    }
+
+    long nonZeros() const {
+        return matrix.nonZeros();
+    }
+
+    Eigen::SparseMatrix<Scalar> &getMatrix() {
+        return matrix;
+    }
+};
+
+// Same as solver.solve(b), which allocates for the in-place permutation.
+// diagonalInv is the inverse of solver.vectorD(), which returns a copy.
+template<typename Scalar>
+void solveLDLT(const Eigen::SimplicialLDLT<Eigen::SparseMatrix<Scalar>> &solver, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &diagonalInv,
+               const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &b, Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &tmp,
+               Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &x) {
+    tmp.noalias() = solver.permutationP() * b;
+    solver.matrixL().solveInPlace(tmp);
+    tmp.array() *= diagonalInv.array();
+    solver.matrixU().solveInPlace(tmp);
+    x.noalias() = solver.permutationPinv() * tmp;
+}
+
+#endif /* assembly_h */
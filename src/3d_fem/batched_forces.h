@@ -0,0 +1,537 @@
+#ifndef batched_forces_h
+#define batched_forces_h
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <cstring>
+#include <string>
+#include "types.h"
+
+/**
+ * Batched evaluation of neo-hookean and corotated forces of many tetrahedra at once.
+ * Rest data (inverse of the rest shape matrix and volumes), gathered vertex positions, rotations of the corotated
+ * model and resulting forces are stored as structure of arrays, so one SIMD register holds the same quantity of 4, 8 or 16 tetrahedra
+ * in single precision and of 2, 4 or 8 in double precision.
+ * The instruction set is chosen at runtime, with a scalar fallback on other CPUs and compilers.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCHED_FORCES_X86
+#endif
+
+// Kernels are inlined into the functions compiled for each instruction set.
+#if defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define FORCE_INLINE inline
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2,
+    AVX512
+};
+
+inline std::string simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE: return "sse";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+// Widest instruction set supported by the CPU.
+inline SimdLevel detectSimdLevel() {
+#ifdef BATCHED_FORCES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Structure of arrays of tetrahedra data, every array holds paddedSize values.
+template<typename Scalar>
+struct TetBatch {
+    // Number of tetrahedra rounded up to the widest batch.
+    long paddedSize = 0;
+    // 9 entries of the inverse rest shape matrix (row-major) followed by volumes.
+    std::vector<Scalar> rest;
+    // Gathered coordinates of 4 vertices, 12 arrays.
+    std::vector<Scalar> positions;
+    // Gradient of the elastic energy with respect to the 12 vertex coordinates.
+    std::vector<Scalar> forces;
+    // Unit quaternions w, x, y, z kept between evaluations of the corotated model, and the squared length of
+    // its last rotation step, 1 where the step wasn't a maximization step.
+    std::vector<Scalar> rotations;
+    std::vector<Scalar> residuals;
+
+    Scalar *restArray(int k) { return &rest[k*paddedSize]; }
+    Scalar *positionArray(int k) { return &positions[k*paddedSize]; }
+    Scalar *forceArray(int k) { return &forces[k*paddedSize]; }
+    Scalar *rotationArray(int k) { return &rotations[k*paddedSize]; }
+};
+
+// Evaluates tetrahedra [begin, end) of a batch, Lane is Scalar or a GCC vector of Scalar.
+// Always inlined, so it is compiled for the instruction set of the caller.
+template<typename Scalar, typename Lane>
+FORCE_INLINE void neoHookeanForcesKernel(Scalar C, Scalar D, TetBatch<Scalar> &batch, long begin, long end) {
+    const long width = sizeof(Lane)/sizeof(Scalar);
+    const Scalar *rest[10];
+    const Scalar *x[12];
+    Scalar *out[12];
+    for (int k = 0; k<10; k++) {
+        rest[k] = batch.restArray(k);
+    }
+    for (int k = 0; k<12; k++) {
+        x[k] = batch.positionArray(k);
+        out[k] = batch.forceArray(k);
+    }
+
+    for (long b = begin; b<end; b += width) {
+        // Inverse rest shape matrix and volume.
+        Lane Ti[9];
+        Lane vol;
+        for (int k = 0; k<9; k++) {
+            std::memcpy(&Ti[k], rest[k] + b, sizeof(Lane));
+        }
+        std::memcpy(&vol, rest[9] + b, sizeof(Lane));
+
+        // Deformed shape matrix, column c is x_{c+1} - x_0.
+        Lane Ds[9];
+        for (int c = 0; c<3; c++) {
+            for (int r = 0; r<3; r++) {
+                Lane x0, xc;
+                std::memcpy(&x0, x[r] + b, sizeof(Lane));
+                std::memcpy(&xc, x[3*(c + 1) + r] + b, sizeof(Lane));
+                Ds[3*r + c] = xc - x0;
+            }
+        }
+
+        // Deformation gradient F = Ds*Ti, row-major.
+        Lane f[9];
+        for (int r = 0; r<3; r++) {
+            for (int c = 0; c<3; c++) {
+                f[3*r + c] = Ds[3*r]*Ti[c] + Ds[3*r + 1]*Ti[3 + c] + Ds[3*r + 2]*Ti[6 + c];
+            }
+        }
+
+        // Derivative of J, the same as in neoHookean().
+        Lane dJ[9];
+        dJ[0] = f[4]*f[8] - f[5]*f[7];
+        dJ[1] = f[5]*f[6] - f[3]*f[8];
+        dJ[2] = f[3]*f[7] - f[4]*f[6];
+        dJ[3] = f[2]*f[7] - f[1]*f[8];
+        dJ[4] = f[0]*f[8] - f[2]*f[6];
+        dJ[5] = f[1]*f[6] - f[0]*f[7];
+        dJ[6] = f[1]*f[5] - f[2]*f[4];
+        dJ[7] = f[2]*f[3] - f[0]*f[5];
+        dJ[8] = f[0]*f[4] - f[1]*f[3];
+        Lane J = f[0]*dJ[0] + f[1]*dJ[1] + f[2]*dJ[2];
+        Lane a = 2*D*(J - 1) - 2*C/J;
+
+        // Gradient of psi with respect to F.
+        Lane P[9];
+        for (int k = 0; k<9; k++) {
+            P[k] = 2*C*f[k] + a*dJ[k];
+        }
+
+        // Forces of vertices 1..3 are vol*P*Ti^T, force of vertex 0 balances them.
+        for (int r = 0; r<3; r++) {
+            Lane sum = P[0]*0;
+            for (int c = 0; c<3; c++) {
+                Lane g = vol*(P[3*r]*Ti[3*c] + P[3*r + 1]*Ti[3*c + 1] + P[3*r + 2]*Ti[3*c + 2]);
+                std::memcpy(out[3*(c + 1) + r] + b, &g, sizeof(Lane));
+                sum += g;
+            }
+            sum = -sum;
+            std::memcpy(out[r] + b, &sum, sizeof(Lane));
+        }
+    }
+}
+
+// Corotated forces of tetrahedra [begin, end), P = 2*mu*(F - R) + lambda*(tr(R^T F) - 3)*R. R is the stored
+// rotation after one Newton step on tr(R^T F), see updateRotation() in materials.h. Tetrahedra whose step isn't
+// small enough to be the last one are left for the caller to redo, their residual tells which.
+template<typename Scalar, typename Lane>
+FORCE_INLINE void corotatedForcesKernel(Scalar mu, Scalar lambda, TetBatch<Scalar> &batch, long begin, long end) {
+    const long width = sizeof(Lane)/sizeof(Scalar);
+    const Scalar *rest[10];
+    const Scalar *x[12];
+    Scalar *out[12];
+    Scalar *quaternion[4];
+    for (int k = 0; k<10; k++) {
+        rest[k] = batch.restArray(k);
+    }
+    for (int k = 0; k<12; k++) {
+        x[k] = batch.positionArray(k);
+        out[k] = batch.forceArray(k);
+    }
+    for (int k = 0; k<4; k++) {
+        quaternion[k] = batch.rotationArray(k);
+    }
+
+    for (long b = begin; b<end; b += width) {
+        Lane Ti[9];
+        Lane vol;
+        for (int k = 0; k<9; k++) {
+            std::memcpy(&Ti[k], rest[k] + b, sizeof(Lane));
+        }
+        std::memcpy(&vol, rest[9] + b, sizeof(Lane));
+
+        Lane Ds[9];
+        for (int c = 0; c<3; c++) {
+            for (int r = 0; r<3; r++) {
+                Lane x0, xc;
+                std::memcpy(&x0, x[r] + b, sizeof(Lane));
+                std::memcpy(&xc, x[3*(c + 1) + r] + b, sizeof(Lane));
+                Ds[3*r + c] = xc - x0;
+            }
+        }
+
+        Lane f[9];
+        for (int r = 0; r<3; r++) {
+            for (int c = 0; c<3; c++) {
+                f[3*r + c] = Ds[3*r]*Ti[c] + Ds[3*r + 1]*Ti[3 + c] + Ds[3*r + 2]*Ti[6 + c];
+            }
+        }
+
+        // Row-major R of the unit quaternion (qw, qx, qy, qz).
+        Lane qw, qx, qy, qz;
+        std::memcpy(&qw, quaternion[0] + b, sizeof(Lane));
+        std::memcpy(&qx, quaternion[1] + b, sizeof(Lane));
+        std::memcpy(&qy, quaternion[2] + b, sizeof(Lane));
+        std::memcpy(&qz, quaternion[3] + b, sizeof(Lane));
+        Lane R[9];
+        R[0] = 1 - 2*(qy*qy + qz*qz);
+        R[1] = 2*(qx*qy - qz*qw);
+        R[2] = 2*(qx*qz + qy*qw);
+        R[3] = 2*(qx*qy + qz*qw);
+        R[4] = 1 - 2*(qx*qx + qz*qz);
+        R[5] = 2*(qy*qz - qx*qw);
+        R[6] = 2*(qx*qz - qy*qw);
+        R[7] = 2*(qy*qz + qx*qw);
+        R[8] = 1 - 2*(qx*qx + qy*qy);
+
+        // S = R^T F, gradient of tr(R^T F) over R*exp(w) and its Hessian H = tr(S)*I - (S + S^T)/2.
+        Lane S[9];
+        for (int r = 0; r<3; r++) {
+            for (int c = 0; c<3; c++) {
+                S[3*r + c] = R[r]*f[c] + R[3 + r]*f[3 + c] + R[6 + r]*f[6 + c];
+            }
+        }
+        Lane g0 = S[7] - S[5], g1 = S[2] - S[6], g2 = S[3] - S[1];
+        Lane trace = S[0] + S[4] + S[8];
+        Lane H00 = trace - S[0], H11 = trace - S[4], H22 = trace - S[8];
+        Lane H01 = -(S[1] + S[3])/2, H02 = -(S[2] + S[6])/2, H12 = -(S[5] + S[7])/2;
+        Lane A00 = H11*H22 - H12*H12, A11 = H00*H22 - H02*H02, A22 = H00*H11 - H01*H01;
+        Lane A01 = H02*H12 - H01*H22, A02 = H01*H12 - H02*H11, A12 = H01*H02 - H00*H12;
+        Lane determinant = H00*A00 + H01*A01 + H02*A02;
+        Lane w0 = (A00*g0 + A01*g1 + A02*g2)/determinant;
+        Lane w1 = (A01*g0 + A11*g1 + A12*g2)/determinant;
+        Lane w2 = (A02*g0 + A12*g1 + A22*g2)/determinant;
+        Lane step = w0*w0 + w1*w1 + w2*w2;
+        // H is positive definite when its leading minors and its determinant are.
+        Lane definite = H00 < A22 ? H00 : A22;
+        definite = definite < determinant ? definite : determinant;
+        Lane residual = definite > 0 ? step : step*0 + 1;
+        std::memcpy(batch.residuals.data() + b, &residual, sizeof(Lane));
+
+        // Quaternion times (1, w/2), renormalized by one Newton step on 1/sqrt, exact to machine precision for
+        // the small steps that are kept.
+        Lane hw0 = w0/2, hw1 = w1/2, hw2 = w2/2;
+        Lane pw = qw - qx*hw0 - qy*hw1 - qz*hw2;
+        Lane px = qx + qw*hw0 + qy*hw2 - qz*hw1;
+        Lane py = qy + qw*hw1 + qz*hw0 - qx*hw2;
+        Lane pz = qz + qw*hw2 + qx*hw1 - qy*hw0;
+        Lane scale = (3 - (pw*pw + px*px + py*py + pz*pz))/2;
+        pw *= scale;
+        px *= scale;
+        py *= scale;
+        pz *= scale;
+        std::memcpy(quaternion[0] + b, &pw, sizeof(Lane));
+        std::memcpy(quaternion[1] + b, &px, sizeof(Lane));
+        std::memcpy(quaternion[2] + b, &py, sizeof(Lane));
+        std::memcpy(quaternion[3] + b, &pz, sizeof(Lane));
+
+        // R*exp(w) to first order, columns of R*[w]x added to R.
+        Lane Rw[9];
+        for (int r = 0; r<3; r++) {
+            Rw[3*r] = R[3*r] + R[3*r + 1]*w2 - R[3*r + 2]*w1;
+            Rw[3*r + 1] = R[3*r + 1] + R[3*r + 2]*w0 - R[3*r]*w2;
+            Rw[3*r + 2] = R[3*r + 2] + R[3*r]*w1 - R[3*r + 1]*w0;
+        }
+        Lane stretch = Rw[0]*f[0] - 3;
+        for (int k = 1; k<9; k++) {
+            stretch += Rw[k]*f[k];
+        }
+        Lane P[9];
+        for (int k = 0; k<9; k++) {
+            P[k] = 2*mu*(f[k] - Rw[k]) + lambda*stretch*Rw[k];
+        }
+
+        for (int r = 0; r<3; r++) {
+            Lane sum = P[0]*0;
+            for (int c = 0; c<3; c++) {
+                Lane g = vol*(P[3*r]*Ti[3*c] + P[3*r + 1]*Ti[3*c + 1] + P[3*r + 2]*Ti[3*c + 2]);
+                std::memcpy(out[3*(c + 1) + r] + b, &g, sizeof(Lane));
+                sum += g;
+            }
+            sum = -sum;
+            std::memcpy(out[r] + b, &sum, sizeof(Lane));
+        }
+    }
+}
+
+template<typename Scalar>
+void neoHookeanForcesScalar(Scalar C, Scalar D, TetBatch<Scalar> &batch, long begin, long end) {
+    neoHookeanForcesKernel<Scalar, Scalar>(C, D, batch, begin, end);
+}
+
+template<typename Scalar>
+void corotatedForcesScalar(Scalar mu, Scalar lambda, TetBatch<Scalar> &batch, long begin, long end) {
+    corotatedForcesKernel<Scalar, Scalar>(mu, lambda, batch, begin, end);
+}
+
+#ifdef BATCHED_FORCES_X86
+typedef float Lane4f __attribute__((vector_size(16)));
+typedef float Lane8f __attribute__((vector_size(32)));
+typedef float Lane16f __attribute__((vector_size(64)));
+typedef double Lane2d __attribute__((vector_size(16)));
+typedef double Lane4d __attribute__((vector_size(32)));
+typedef double Lane8d __attribute__((vector_size(64)));
+
+__attribute__((target("sse2")))
+inline void neoHookeanForcesSSE(float C, float D, TetBatch<float> &batch, long begin, long end) {
+    neoHookeanForcesKernel<float, Lane4f>(C, D, batch, begin, end);
+}
+
+__attribute__((target("sse2")))
+inline void neoHookeanForcesSSE(double C, double D, TetBatch<double> &batch, long begin, long end) {
+    neoHookeanForcesKernel<double, Lane2d>(C, D, batch, begin, end);
+}
+
+__attribute__((target("sse2")))
+inline void corotatedForcesSSE(float mu, float lambda, TetBatch<float> &batch, long begin, long end) {
+    corotatedForcesKernel<float, Lane4f>(mu, lambda, batch, begin, end);
+}
+
+__attribute__((target("sse2")))
+inline void corotatedForcesSSE(double mu, double lambda, TetBatch<double> &batch, long begin, long end) {
+    corotatedForcesKernel<double, Lane2d>(mu, lambda, batch, begin, end);
+}
+
+__attribute__((target("avx2,fma")))
+inline void neoHookeanForcesAVX2(float C, float D, TetBatch<float> &batch, long begin, long end) {
+    neoHookeanForcesKernel<float, Lane8f>(C, D, batch, begin, end);
+}
+
+__attribute__((target("avx2,fma")))
+inline void neoHookeanForcesAVX2(double C, double D, TetBatch<double> &batch, long begin, long end) {
+    neoHookeanForcesKernel<double, Lane4d>(C, D, batch, begin, end);
+}
+
+__attribute__((target("avx2,fma")))
+inline void corotatedForcesAVX2(float mu, float lambda, TetBatch<float> &batch, long begin, long end) {
+    corotatedForcesKernel<float, Lane8f>(mu, lambda, batch, begin, end);
+}
+
+__attribute__((target("avx2,fma")))
+inline void corotatedForcesAVX2(double mu, double lambda, TetBatch<double> &batch, long begin, long end) {
+    corotatedForcesKernel<double, Lane4d>(mu, lambda, batch, begin, end);
+}
+
+__attribute__((target("avx512f")))
+inline void neoHookeanForcesAVX512(float C, float D, TetBatch<float> &batch, long begin, long end) {
+    neoHookeanForcesKernel<float, Lane16f>(C, D, batch, begin, end);
+}
+
+__attribute__((target("avx512f")))
+inline void neoHookeanForcesAVX512(double C, double D, TetBatch<double> &batch, long begin, long end) {
+    neoHookeanForcesKernel<double, Lane8d>(C, D, batch, begin, end);
+}
+
+__attribute__((target("avx512f")))
+inline void corotatedForcesAVX512(float mu, float lambda, TetBatch<float> &batch, long begin, long end) {
+    corotatedForcesKernel<float, Lane16f>(mu, lambda, batch, begin, end);
+}
+
+__attribute__((target("avx512f")))
+inline void corotatedForcesAVX512(double mu, double lambda, TetBatch<double> &batch, long begin, long end) {
+    corotatedForcesKernel<double, Lane8d>(mu, lambda, batch, begin, end);
+}
+#endif
+
+template<typename Scalar>
+class BatchedElementForces {
+
+private:
+    TetBatch<Scalar> batch;
+    long n_tet = 0;
+    SimdLevel level = SimdLevel::Scalar;
+
+public:
+    // Tetrahedra are processed by chunks of this many, a multiple of every SIMD width.
+    static const int chunkSize = 256;
+
+    BatchedElementForces() = default;
+
+    template<typename Element>
+    BatchedElementForces(const AlignedVector<Element> &elements) {
+        n_tet = elements.size();
+        batch.paddedSize = (n_tet + chunkSize - 1)/chunkSize*chunkSize;
+        batch.rest.assign(10*batch.paddedSize, 0);
+        batch.positions.assign(12*batch.paddedSize, 0);
+        batch.forces.assign(12*batch.paddedSize, 0);
+        batch.rotations.assign(4*batch.paddedSize, 0);
+        batch.residuals.assign(batch.paddedSize, 0);
+        std::fill(batch.rotations.begin(), batch.rotations.begin() + batch.paddedSize, 1);
+        for (long i = 0; i<batch.paddedSize; i++) {
+            // Padding lanes hold a unit rest shape with zero volume, so they stay finite.
+            Eigen::Matrix<Scalar, 3, 3> T_inv = Eigen::Matrix<Scalar, 3, 3>::Identity();
+            if (i < n_tet) {
+                T_inv = elements[i].D.template bottomRows<3>().template cast<Scalar>();
+            }
+            for (int k = 0; k<9; k++) {
+                batch.restArray(k)[i] = T_inv(k/3, k%3);
+            }
+            batch.restArray(9)[i] = i < n_tet ? elements[i].volume : 0;
+            if (i >= n_tet) {
+                for (int k = 0; k<3; k++) {
+                    batch.positionArray(3*(k + 1) + k)[i] = 1;
+                }
+            }
+        }
+        level = detectSimdLevel();
+    }
+
+    // Uses a specific instruction set, for benchmarks and consistency checks.
+    // Falls back to the detected one if the CPU doesn't support it.
+    void setSimdLevel(SimdLevel simdLevel) {
+        level = std::min(simdLevel, detectSimdLevel());
+    }
+
+    SimdLevel getSimdLevel() {
+        return level;
+    }
+
+    long chunks() {
+        return batch.paddedSize/chunkSize;
+    }
+
+    // Copies coordinates of i-th tetrahedron vertices into the batch, converting them to Scalar.
+    template<typename Derived>
+    void gather(long i, const TetIndices &tetIndex, const Eigen::MatrixBase<Derived> &qq) {
+        for (int j = 0; j<4; j++) {
+            for (int k = 0; k<3; k++) {
+                batch.positionArray(3*j + k)[i] = (Scalar)qq[3*tetIndex[j] + k];
+            }
+        }
+    }
+
+    // Evaluates forces of tetrahedra in chunk c.
+    void evaluate(Scalar C, Scalar D, long c) {
+        long begin = c*chunkSize;
+        long end = begin + chunkSize;
+        switch (level) {
+#ifdef BATCHED_FORCES_X86
+            case SimdLevel::AVX512:
+                neoHookeanForcesAVX512(C, D, batch, begin, end);
+                break;
+            case SimdLevel::AVX2:
+                neoHookeanForcesAVX2(C, D, batch, begin, end);
+                break;
+            case SimdLevel::SSE:
+                neoHookeanForcesSSE(C, D, batch, begin, end);
+                break;
+#endif
+            default:
+                neoHookeanForcesScalar(C, D, batch, begin, end);
+        }
+    }
+
+    // Evaluates corotated forces of tetrahedra in chunk c from their stored rotations, see converged().
+    void evaluateCorotated(Scalar mu, Scalar lambda, long c) {
+        long begin = c*chunkSize;
+        long end = begin + chunkSize;
+        switch (level) {
+#ifdef BATCHED_FORCES_X86
+            case SimdLevel::AVX512:
+                corotatedForcesAVX512(mu, lambda, batch, begin, end);
+                break;
+            case SimdLevel::AVX2:
+                corotatedForcesAVX2(mu, lambda, batch, begin, end);
+                break;
+            case SimdLevel::SSE:
+                corotatedForcesSSE(mu, lambda, batch, begin, end);
+                break;
+#endif
+            default:
+                corotatedForcesScalar(mu, lambda, batch, begin, end);
+        }
+    }
+
+    // Gradient of the elastic energy of i-th tetrahedron with respect to coordinate k of its vertices.
+    Scalar force(long i, int k) {
+        return batch.forceArray(k)[i];
+    }
+
+    // False if the last corotated evaluation of i-th tetrahedron needs more than one rotation step, its forces and
+    // rotation are then set with setStress() and setRotation().
+    bool converged(long i) {
+        return batch.residuals[i] < std::numeric_limits<Scalar>::epsilon();
+    }
+
+    // Row-major deformation gradient of i-th tetrahedron at the gathered positions.
+    Vector9<Scalar> deformationGradient(long i) {
+        Eigen::Matrix<Scalar, 3, 3> Ds, Ti;
+        for (int k = 0; k<9; k++) {
+            Ds(k%3, k/3) = batch.positionArray(k + 3)[i] - batch.positionArray(k%3)[i];
+            Ti(k/3, k%3) = batch.restArray(k)[i];
+        }
+        Vector9<Scalar> f;
+        Eigen::Map<Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data()) = Ds*Ti;
+        return f;
+    }
+
+    // Sets forces of i-th tetrahedron from the row-major gradient of the energy density with respect to F.
+    void setStress(long i, const Vector9<Scalar> &P) {
+        for (int r = 0; r<3; r++) {
+            Scalar sum = 0;
+            for (int c = 0; c<3; c++) {
+                Scalar g = batch.restArray(9)[i]*(P[3*r]*batch.restArray(3*c)[i] + P[3*r + 1]*batch.restArray(3*c + 1)[i]
+                                                  + P[3*r + 2]*batch.restArray(3*c + 2)[i]);
+                batch.forceArray(3*(c + 1) + r)[i] = g;
+                sum += g;
+            }
+            batch.forceArray(r)[i] = -sum;
+        }
+    }
+
+    Eigen::Quaternion<Scalar> rotation(long i) {
+        return Eigen::Quaternion<Scalar>(batch.rotationArray(0)[i], batch.rotationArray(1)[i],
+                                         batch.rotationArray(2)[i], batch.rotationArray(3)[i]);
+    }
+
+    void setRotation(long i, const Eigen::Quaternion<Scalar> &rotation) {
+        batch.rotationArray(0)[i] = rotation.w();
+        batch.rotationArray(1)[i] = rotation.x();
+        batch.rotationArray(2)[i] = rotation.y();
+        batch.rotationArray(3)[i] = rotation.z();
+    }
+};
+
+#endif /* batched_forces_h */
@@ -0,0 +1,84 @@
+#ifndef conjugate_gradient_h
+#define conjugate_gradient_h
+
+#include <Eigen/Dense>
+#include <math.h>
+
+/**
+ * Preconditioned conjugate gradient for a symmetric system A*x = b, where neither A nor the preconditioner
+ * are stored as matrices: both are given as functions applied to a vector.
+ * Work vectors are kept between solves, so a solve doesn't allocate once they are sized.
+ */
+template<typename Scalar>
+class ConjugateGradient {
+
+private:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+    // Residual, preconditioned residual, search direction and A times search direction.
+    Vector r;
+    Vector z;
+    Vector p;
+    Vector Ap;
+
+public:
+    // Solve stops when the residual norm drops below tolerance times the norm of b.
+    Scalar tolerance = 1e-4f;
+    int maxIterations = 500;
+    // Iterations made and relative residual reached by the last solve.
+    int iterations = 0;
+    Scalar error = 0;
+
+    void resize(long size) {
+        r.setZero(size);
+        z.setZero(size);
+        p.setZero(size);
+        Ap.setZero(size);
+    }
+
+    // apply(v, out) sets out = A*v, precondition(v, out) sets out to the approximate inverse of A times v.
+    // x holds the initial guess and receives the solution.
+    // Stops early if the search direction has non-positive curvature, A is then not positive definite.
+    template<typename Apply, typename Precondition>
+    void solve(Apply apply, Precondition precondition, const Vector &b, Vector &x) {
+        iterations = 0;
+        Scalar bNorm = b.norm();
+        if (bNorm == 0) {
+            x.setZero();
+            error = 0;
+            return;
+        }
+
+        apply(x, Ap);
+        r = b - Ap;
+        error = r.norm()/bNorm;
+        if (error <= tolerance) {
+            return;
+        }
+        precondition(r, z);
+        p = z;
+        Scalar rz = r.dot(z);
+
+        while (iterations < maxIterations) {
+            apply(p, Ap);
+            Scalar curvature = p.dot(Ap);
+            if (!(curvature > 0)) {
+                break;
+            }
+            Scalar alpha = rz/curvature;
+            x += alpha*p;
+            r -= alpha*Ap;
+            iterations++;
+
+            error = r.norm()/bNorm;
+            if (error <= tolerance) {
+                break;
+            }
+            precondition(r, z);
+            Scalar rzNew = r.dot(z);
+            p = z + (rzNew/rz)*p;
+            rz = rzNew;
+        }
+    }
+};
+
+#endif /* conjugate_gradient_h */
@@ -0,0 +1,204 @@
+#ifndef cubature_h
+#define cubature_h
+
+#include <Eigen/Dense>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Non-negative least squares min |A*x - b| with x >= 0 given by the normal equations G = A^T*A and c = A^T*b
+// (Lawson-Hanson active set), starting from x. Columns where x is positive are the passive set, their least
+// squares solution is taken as long as it stays positive, otherwise the step is cut where the first weight
+// reaches 0. A start with the solution of a problem with fewer columns usually needs a single solve.
+inline void nonNegativeLeastSquares(const Eigen::MatrixXd &G, const Eigen::VectorXd &c, Eigen::VectorXd &x) {
+    long m = G.cols();
+    std::vector<bool> passive(m);
+    for (long j = 0; j<m; j++) {
+        passive[j] = x[j] > 0;
+        x[j] = std::max(x[j], 0.0);
+    }
+    double tolerance = 1e-12*std::max(1.0, c.cwiseAbs().maxCoeff());
+    std::vector<long> indices;
+    Eigen::MatrixXd G_p;
+    Eigen::VectorXd c_p;
+    for (long iteration = 0; iteration<3*m; iteration++) {
+        while (true) {
+            indices.clear();
+            for (long j = 0; j<m; j++) {
+                if (passive[j]) {
+                    indices.push_back(j);
+                }
+            }
+            long p = indices.size();
+            if (p == 0) {
+                break;
+            }
+            G_p.resize(p, p);
+            c_p.resize(p);
+            for (long j = 0; j<p; j++) {
+                c_p[j] = c[indices[j]];
+                for (long k = 0; k<p; k++) {
+                    G_p(j, k) = G(indices[j], indices[k]);
+                }
+            }
+            Eigen::VectorXd z = G_p.ldlt().solve(c_p);
+            if (z.minCoeff() > 0) {
+                for (long j = 0; j<p; j++) {
+                    x[indices[j]] = z[j];
+                }
+                break;
+            }
+            // Moving towards z until the first passive weight hits 0, which leaves the passive set.
+            double alpha = 1;
+            for (long j = 0; j<p; j++) {
+                if (z[j] <= 0) {
+                    alpha = std::min(alpha, x[indices[j]]/(x[indices[j]] - z[j]));
+                }
+            }
+            for (long j = 0; j<p; j++) {
+                x[indices[j]] += alpha*(z[j] - x[indices[j]]);
+                if (x[indices[j]] <= 1e-12*z.cwiseAbs().maxCoeff()) {
+                    x[indices[j]] = 0;
+                    passive[indices[j]] = false;
+                }
+            }
+        }
+        
+        // Gradient of -|A*x - b|^2/2, positive where increasing a weight lowers the residual.
+        Eigen::VectorXd w = c - G*x;
+        long best = -1;
+        for (long j = 0; j<m; j++) {
+            if (!passive[j] && w[j] > tolerance && (best < 0 || w[j] > w[best])) {
+                best = j;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        passive[best] = true;
+    }
+}
+
+/**
+ * Weighted subset of tetrahedra whose weighted sum of some per-tetrahedron quantity approximates the sum over all
+ * of them (optimized cubature). Training takes the contributions of every tetrahedron on a set of samples as a
+ * column of A and the full sums as b. Tetrahedra are picked greedily by correlation with the residual and the
+ * weights of the picked ones are refitted with non-negative least squares after every pick.
+ * Results are cached in a binary file keyed by the caller.
+ */
+class Cubature {
+
+public:
+    std::vector<int> tets;
+    std::vector<double> weights;
+    // Relative residual |A*w - b|/|b| reached by training.
+    double error = 1;
+
+    // Stops when the relative residual is below tolerance or maxTets are picked.
+    void train(const Eigen::MatrixXd &A, const Eigen::VectorXd &b, double tolerance, int maxTets) {
+        tets.clear();
+        weights.clear();
+        double bNorm = b.norm();
+        error = bNorm > 0 ? 1 : 0;
+        Eigen::VectorXd columnNorms = A.colwise().norm().transpose();
+        Eigen::VectorXd residual = b;
+        // Normal equations of the picked columns, grown by a row and a column per pick.
+        Eigen::MatrixXd G(0, 0);
+        Eigen::VectorXd c(0);
+        Eigen::VectorXd x(0);
+        std::vector<int> picked;
+        std::vector<bool> taken(A.cols(), false);
+        while (error > tolerance && (int)picked.size()<maxTets) {
+            Eigen::VectorXd scores = A.transpose()*residual;
+            long best = -1;
+            for (long j = 0; j<A.cols(); j++) {
+                if (!taken[j] && columnNorms[j] > 0) {
+                    scores[j] /= columnNorms[j];
+                    if (scores[j] > 0 && (best < 0 || scores[j] > scores[best])) {
+                        best = j;
+                    }
+                }
+            }
+            if (best < 0) {
+                break;
+            }
+            taken[best] = true;
+            picked.push_back(best);
+            long m = picked.size();
+            Eigen::VectorXd column(m);
+            for (long j = 0; j<m; j++) {
+                column[j] = A.col(picked[j]).dot(A.col(best));
+            }
+            G.conservativeResize(m, m);
+            G.row(m - 1) = column.transpose();
+            G.col(m - 1) = column;
+            c.conservativeResize(m);
+            c[m - 1] = A.col(best).dot(b);
+
+            x.conservativeResize(m);
+            x[m - 1] = 0;
+            nonNegativeLeastSquares(G, c, x);
+            residual = b;
+            for (long j = 0; j<m; j++) {
+                residual -= x[j]*A.col(picked[j]);
+            }
+            error = residual.norm()/bNorm;
+            tets.clear();
+            weights.clear();
+            for (long j = 0; j<m; j++) {
+                if (x[j] > 0) {
+                    tets.push_back(picked[j]);
+                    weights.push_back(x[j]);
+                }
+            }
+        }
+    }
+
+    // Reads a cubature saved with the same key over tetCount tetrahedra. Files that are truncated, or whose tetrahedra
+    // or weights are out of range, are rejected and leave the cubature empty.
+    bool load(const std::string &path, uint64_t key, int tetCount) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[4];
+        uint64_t fileKey = 0;
+        int count = 0;
+        if (!file.read(magic, 4) || std::memcmp(magic, "CUB1", 4) != 0 ||
+            !file.read((char *)&fileKey, sizeof(fileKey)) || fileKey != key ||
+            !file.read((char *)&count, sizeof(count)) || count < 0 || count > tetCount) {
+            return false;
+        }
+        file.read((char *)&error, sizeof(error));
+        tets.resize(count);
+        weights.resize(count);
+        file.read((char *)tets.data(), count*sizeof(int));
+        bool valid = (bool)file.read((char *)weights.data(), count*sizeof(double));
+        for (int j = 0; valid && j<count; j++) {
+            valid = tets[j] >= 0 && tets[j] < tetCount && std::isfinite(weights[j]) && weights[j] > 0;
+        }
+        if (!valid) {
+            tets.clear();
+            weights.clear();
+            error = 1;
+        }
+        return valid;
+    }
+
+    void save(const std::string &path, uint64_t key) const {
+        std::ofstream file(path, std::ios::binary);
+        int count = tets.size();
+        file.write("CUB1", 4);
+        file.write((const char *)&key, sizeof(key));
+        file.write((const char *)&count, sizeof(count));
+        file.write((const char *)&error, sizeof(error));
+        file.write((const char *)tets.data(), count*sizeof(int));
+        file.write((const char *)weights.data(), count*sizeof(double));
+        if (!file) {
+            std::cout << "Failed to write cubature cache " << path << std::endl;
+        }
+    }
+};
+
+#endif /* cubature_h */
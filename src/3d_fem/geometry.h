@@ -0,0 +1,88 @@
+#ifndef geometry_h
+#define geometry_h
+
+#include <Eigen/Dense>
+#include <cmath>
+
+/**
+ * Point queries against triangles shared by spatial structures, in the precision of their arguments.
+ */
+
+// Closest point to p on triangle abc (Ericson, Real-Time Collision Detection, 5.1.5).
+template<typename Scalar>
+Eigen::Matrix<Scalar, 3, 1> closestPointOnTriangle(const Eigen::Matrix<Scalar, 3, 1> &p, const Eigen::Matrix<Scalar, 3, 1> &a,
+                                                   const Eigen::Matrix<Scalar, 3, 1> &b, const Eigen::Matrix<Scalar, 3, 1> &c) {
+    Eigen::Matrix<Scalar, 3, 1> ab = b - a;
+    Eigen::Matrix<Scalar, 3, 1> ac = c - a;
+    Eigen::Matrix<Scalar, 3, 1> ap = p - a;
+    Scalar d1 = ab.dot(ap);
+    Scalar d2 = ac.dot(ap);
+    if (d1 <= 0 && d2 <= 0) {
+        return a;
+    }
+    Eigen::Matrix<Scalar, 3, 1> bp = p - b;
+    Scalar d3 = ab.dot(bp);
+    Scalar d4 = ac.dot(bp);
+    if (d3 >= 0 && d4 <= d3) {
+        return b;
+    }
+    Scalar vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        return a + d1/(d1 - d3)*ab;
+    }
+    Eigen::Matrix<Scalar, 3, 1> cp = p - c;
+    Scalar d5 = ab.dot(cp);
+    Scalar d6 = ac.dot(cp);
+    if (d6 >= 0 && d5 <= d6) {
+        return c;
+    }
+    Scalar vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        return a + d2/(d2 - d6)*ac;
+    }
+    Scalar va = d3*d6 - d5*d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        return b + (d4 - d3)/((d4 - d3) + (d5 - d6))*(c - b);
+    }
+    Scalar denominator = 1/(va + vb + vc);
+    return a + ab*vb*denominator + ac*vc*denominator;
+}
+
+// Barycentric coordinates of p projected onto the plane of triangle abc, (1, 0, 0) for degenerate triangles.
+template<typename Scalar>
+Eigen::Matrix<Scalar, 3, 1> triangleBarycentric(const Eigen::Matrix<Scalar, 3, 1> &p, const Eigen::Matrix<Scalar, 3, 1> &a,
+                                                const Eigen::Matrix<Scalar, 3, 1> &b, const Eigen::Matrix<Scalar, 3, 1> &c) {
+    Eigen::Matrix<Scalar, 3, 1> ab = b - a;
+    Eigen::Matrix<Scalar, 3, 1> ac = c - a;
+    Eigen::Matrix<Scalar, 3, 1> ap = p - a;
+    Scalar d00 = ab.dot(ab);
+    Scalar d01 = ab.dot(ac);
+    Scalar d11 = ac.dot(ac);
+    Scalar d20 = ap.dot(ab);
+    Scalar d21 = ap.dot(ac);
+    Scalar denominator = d00*d11 - d01*d01;
+    if (!(denominator > 0)) {
+        return Eigen::Matrix<Scalar, 3, 1>(1, 0, 0);
+    }
+    Scalar v = (d11*d20 - d01*d21)/denominator;
+    Scalar w = (d00*d21 - d01*d20)/denominator;
+    return Eigen::Matrix<Scalar, 3, 1>(1 - v - w, v, w);
+}
+
+// Solid angle of triangle abc seen from p, positive when the triangle winds counterclockwise around
+// the direction from p (Van Oosterom and Strackee). Sums to 4*pi over a closed outward facing surface around p.
+template<typename Scalar>
+Scalar solidAngle(const Eigen::Matrix<Scalar, 3, 1> &p, const Eigen::Matrix<Scalar, 3, 1> &a,
+                  const Eigen::Matrix<Scalar, 3, 1> &b, const Eigen::Matrix<Scalar, 3, 1> &c) {
+    Eigen::Matrix<Scalar, 3, 1> x = a - p;
+    Eigen::Matrix<Scalar, 3, 1> y = b - p;
+    Eigen::Matrix<Scalar, 3, 1> z = c - p;
+    Scalar lx = x.norm();
+    Scalar ly = y.norm();
+    Scalar lz = z.norm();
+    Scalar numerator = x.dot(y.cross(z));
+    Scalar denominator = lx*ly*lz + x.dot(y)*lz + x.dot(z)*ly + y.dot(z)*lx;
+    return 2*std::atan2(numerator, denominator);
+}
+
+#endif /* geometry_h */
@@ -1,743 +1,826 @@
 #ifndef hessian_h
 #define hessian_h
 
-#include <math.h>
+#include <cmath>
 #include <Eigen/Dense>
+#include "types.h"
 
 /**
- * Hesian of neo-hookean density function. Autogenerated in algebra software.
+ * Hesian of neo-hookean density function. Autogenerated in algebra software, templated the same way as gradient.h.
  */
 
-float psi_hessian00(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian00(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian00_result;
-   psi_hessian00_result = 2*C*(pow(-f11*f22 + f12*f21, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f11*f22 + f12*f21, 2);
+   Scalar psi_hessian00_result;
+   psi_hessian00_result = 2*C*(std::pow(-f11*f22 + f12*f21, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f11*f22 + f12*f21, Scalar(2));
    return psi_hessian00_result;
 
 }
 
 
-float psi_hessian01(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian01(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian01_result;
-   psi_hessian01_result = -2*C*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian01_result;
+   psi_hessian01_result = -2*C*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21);
    return psi_hessian01_result;
 
 }
 
 
-float psi_hessian02(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian02(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian02_result;
-   psi_hessian02_result = 2*C*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian02_result;
+   psi_hessian02_result = 2*C*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21);
    return psi_hessian02_result;
 
 }
 
 
-float psi_hessian03(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian03(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian03_result;
-   psi_hessian03_result = -2*C*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian03_result;
+   psi_hessian03_result = -2*C*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21);
    return psi_hessian03_result;
 
 }
 
 
-float psi_hessian04(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian04(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian04_result;
-   psi_hessian04_result = 2*C*(f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian04_result;
+   psi_hessian04_result = 2*C*(f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f11*f22 + f12*f21);
    return psi_hessian04_result;
 
 }
 
 
-float psi_hessian05(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian05(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian05_result;
-   psi_hessian05_result = -2*C*(f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian05_result;
+   psi_hessian05_result = -2*C*(f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f11*f22 + f12*f21);
    return psi_hessian05_result;
 
 }
 
 
-float psi_hessian06(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian06(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian06_result;
-   psi_hessian06_result = 2*C*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian06_result;
+   psi_hessian06_result = 2*C*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21);
    return psi_hessian06_result;
 
 }
 
 
-float psi_hessian07(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian07(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian07_result;
-   psi_hessian07_result = -2*C*(f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian07_result;
+   psi_hessian07_result = -2*C*(f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f11*f22 + f12*f21);
    return psi_hessian07_result;
 
 }
 
 
-float psi_hessian08(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian08(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian08_result;
-   psi_hessian08_result = 2*C*(f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian08_result;
+   psi_hessian08_result = 2*C*(f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f11*f22 + f12*f21);
    return psi_hessian08_result;
 
 }
 
 
-float psi_hessian10(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian10(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian10_result;
-   psi_hessian10_result = -2*C*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian10_result;
+   psi_hessian10_result = -2*C*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f10*f22 + f12*f20)*(-f11*f22 + f12*f21);
    return psi_hessian10_result;
 
 }
 
 
-float psi_hessian11(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian11(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian11_result;
-   psi_hessian11_result = 2*C*(pow(-f10*f22 + f12*f20, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f10*f22 + f12*f20, 2);
+   Scalar psi_hessian11_result;
+   psi_hessian11_result = 2*C*(std::pow(-f10*f22 + f12*f20, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f10*f22 + f12*f20, Scalar(2));
    return psi_hessian11_result;
 
 }
 
 
-float psi_hessian12(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian12(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian12_result;
-   psi_hessian12_result = -2*C*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian12_result;
+   psi_hessian12_result = -2*C*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20);
    return psi_hessian12_result;
 
 }
 
 
-float psi_hessian13(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian13(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian13_result;
-   psi_hessian13_result = 2*C*(-f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f22 + f02*f21)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian13_result;
+   psi_hessian13_result = 2*C*(-f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f22 + f02*f21)*(-f10*f22 + f12*f20);
    return psi_hessian13_result;
 
 }
 
 
-float psi_hessian14(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian14(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian14_result;
-   psi_hessian14_result = -2*C*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian14_result;
+   psi_hessian14_result = -2*C*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20);
    return psi_hessian14_result;
 
 }
 
 
-float psi_hessian15(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian15(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian15_result;
-   psi_hessian15_result = 2*C*(f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f21 + f01*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian15_result;
+   psi_hessian15_result = 2*C*(f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f21 + f01*f20)*(-f10*f22 + f12*f20);
    return psi_hessian15_result;
 
 }
 
 
-float psi_hessian16(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian16(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian16_result;
-   psi_hessian16_result = -2*C*(-f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f12 + f02*f11)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian16_result;
+   psi_hessian16_result = -2*C*(-f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f12 + f02*f11)*(-f10*f22 + f12*f20);
    return psi_hessian16_result;
 
 }
 
 
-float psi_hessian17(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian17(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian17_result;
-   psi_hessian17_result = 2*C*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian17_result;
+   psi_hessian17_result = 2*C*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20);
    return psi_hessian17_result;
 
 }
 
 
-float psi_hessian18(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian18(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian18_result;
-   psi_hessian18_result = -2*C*(f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian18_result;
+   psi_hessian18_result = -2*C*(f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f10*f22 + f12*f20);
    return psi_hessian18_result;
 
 }
 
 
-float psi_hessian20(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian20(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian20_result;
-   psi_hessian20_result = 2*C*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian20_result;
+   psi_hessian20_result = 2*C*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f10*f21 + f11*f20)*(-f11*f22 + f12*f21);
    return psi_hessian20_result;
 
 }
 
 
-float psi_hessian21(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian21(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian21_result;
-   psi_hessian21_result = -2*C*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian21_result;
+   psi_hessian21_result = -2*C*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f10*f21 + f11*f20)*(-f10*f22 + f12*f20);
    return psi_hessian21_result;
 
 }
 
 
-float psi_hessian22(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian22(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian22_result;
-   psi_hessian22_result = 2*C*(pow(-f10*f21 + f11*f20, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f10*f21 + f11*f20, 2);
+   Scalar psi_hessian22_result;
+   psi_hessian22_result = 2*C*(std::pow(-f10*f21 + f11*f20, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f10*f21 + f11*f20, Scalar(2));
    return psi_hessian22_result;
 
 }
 
 
-float psi_hessian23(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian23(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian23_result;
-   psi_hessian23_result = -2*C*(-f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f22 + f02*f21)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian23_result;
+   psi_hessian23_result = -2*C*(-f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f22 + f02*f21)*(-f10*f21 + f11*f20);
    return psi_hessian23_result;
 
 }
 
 
-float psi_hessian24(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian24(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian24_result;
-   psi_hessian24_result = 2*C*(-f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian24_result;
+   psi_hessian24_result = 2*C*(-f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f10*f21 + f11*f20);
    return psi_hessian24_result;
 
 }
 
 
-float psi_hessian25(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian25(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian25_result;
-   psi_hessian25_result = -2*C*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian25_result;
+   psi_hessian25_result = -2*C*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20);
    return psi_hessian25_result;
 
 }
 
 
-float psi_hessian26(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian26(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian26_result;
-   psi_hessian26_result = 2*C*(-f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f12 + f02*f11)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian26_result;
+   psi_hessian26_result = 2*C*(-f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f12 + f02*f11)*(-f10*f21 + f11*f20);
    return psi_hessian26_result;
 
 }
 
 
-float psi_hessian27(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian27(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian27_result;
-   psi_hessian27_result = -2*C*(-f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian27_result;
+   psi_hessian27_result = -2*C*(-f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f10*f21 + f11*f20);
    return psi_hessian27_result;
 
 }
 
 
-float psi_hessian28(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian28(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian28_result;
-   psi_hessian28_result = 2*C*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian28_result;
+   psi_hessian28_result = 2*C*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20);
    return psi_hessian28_result;
 
 }
 
 
-float psi_hessian30(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian30(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian30_result;
-   psi_hessian30_result = -2*C*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian30_result;
+   psi_hessian30_result = -2*C*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f01*f22 + f02*f21)*(-f11*f22 + f12*f21);
    return psi_hessian30_result;
 
 }
 
 
-float psi_hessian31(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian31(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian31_result;
-   psi_hessian31_result = 2*C*(-f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f22 + f02*f21)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian31_result;
+   psi_hessian31_result = 2*C*(-f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f22 + f02*f21)*(-f10*f22 + f12*f20);
    return psi_hessian31_result;
 
 }
 
 
-float psi_hessian32(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian32(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian32_result;
-   psi_hessian32_result = -2*C*(-f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f22 + f02*f21)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian32_result;
+   psi_hessian32_result = -2*C*(-f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f22 + f02*f21)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f22 + f02*f21)*(-f10*f21 + f11*f20);
    return psi_hessian32_result;
 
 }
 
 
-float psi_hessian33(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian33(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian33_result;
-   psi_hessian33_result = 2*C*(pow(-f01*f22 + f02*f21, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f01*f22 + f02*f21, 2);
+   Scalar psi_hessian33_result;
+   psi_hessian33_result = 2*C*(std::pow(-f01*f22 + f02*f21, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f01*f22 + f02*f21, Scalar(2));
    return psi_hessian33_result;
 
 }
 
 
-float psi_hessian34(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian34(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian34_result;
-   psi_hessian34_result = -2*C*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian34_result;
+   psi_hessian34_result = -2*C*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21);
    return psi_hessian34_result;
 
 }
 
 
-float psi_hessian35(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian35(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian35_result;
-   psi_hessian35_result = 2*C*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian35_result;
+   psi_hessian35_result = 2*C*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21);
    return psi_hessian35_result;
 
 }
 
 
-float psi_hessian36(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian36(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian36_result;
-   psi_hessian36_result = -2*C*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian36_result;
+   psi_hessian36_result = -2*C*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21);
    return psi_hessian36_result;
 
 }
 
 
-float psi_hessian37(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian37(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian37_result;
-   psi_hessian37_result = 2*C*(f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian37_result;
+   psi_hessian37_result = 2*C*(f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f01*f22 + f02*f21);
    return psi_hessian37_result;
 
 }
 
 
-float psi_hessian38(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian38(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian38_result;
-   psi_hessian38_result = -2*C*(f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian38_result;
+   psi_hessian38_result = -2*C*(f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f01*f22 + f02*f21);
    return psi_hessian38_result;
 
 }
 
 
-float psi_hessian40(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian40(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian40_result;
-   psi_hessian40_result = 2*C*(f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian40_result;
+   psi_hessian40_result = 2*C*(f22/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f22*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f11*f22 + f12*f21);
    return psi_hessian40_result;
 
 }
 
 
-float psi_hessian41(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian41(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian41_result;
-   psi_hessian41_result = -2*C*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian41_result;
+   psi_hessian41_result = -2*C*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f22 + f02*f20)*(-f10*f22 + f12*f20);
    return psi_hessian41_result;
 
 }
 
 
-float psi_hessian42(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian42(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian42_result;
-   psi_hessian42_result = 2*C*(-f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian42_result;
+   psi_hessian42_result = 2*C*(-f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f10*f21 + f11*f20);
    return psi_hessian42_result;
 
 }
 
 
-float psi_hessian43(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian43(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian43_result;
-   psi_hessian43_result = -2*C*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian43_result;
+   psi_hessian43_result = -2*C*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f22 + f02*f20)*(-f01*f22 + f02*f21);
    return psi_hessian43_result;
 
 }
 
 
-float psi_hessian44(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian44(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian44_result;
-   psi_hessian44_result = 2*C*(pow(-f00*f22 + f02*f20, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f00*f22 + f02*f20, 2);
+   Scalar psi_hessian44_result;
+   psi_hessian44_result = 2*C*(std::pow(-f00*f22 + f02*f20, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f00*f22 + f02*f20, Scalar(2));
    return psi_hessian44_result;
 
 }
 
 
-float psi_hessian45(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian45(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian45_result;
-   psi_hessian45_result = -2*C*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian45_result;
+   psi_hessian45_result = -2*C*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20);
    return psi_hessian45_result;
 
 }
 
 
-float psi_hessian46(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian46(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian46_result;
-   psi_hessian46_result = 2*C*(-f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian46_result;
+   psi_hessian46_result = 2*C*(-f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f01*f12 + f02*f11);
    return psi_hessian46_result;
 
 }
 
 
-float psi_hessian47(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian47(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian47_result;
-   psi_hessian47_result = -2*C*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian47_result;
+   psi_hessian47_result = -2*C*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20);
    return psi_hessian47_result;
 
 }
 
 
-float psi_hessian48(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian48(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian48_result;
-   psi_hessian48_result = 2*C*(f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian48_result;
+   psi_hessian48_result = 2*C*(f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f00*f22 + f02*f20);
    return psi_hessian48_result;
 
 }
 
 
-float psi_hessian50(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian50(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian50_result;
-   psi_hessian50_result = -2*C*(f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian50_result;
+   psi_hessian50_result = -2*C*(f21/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f21*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f11*f22 + f12*f21);
    return psi_hessian50_result;
 
 }
 
 
-float psi_hessian51(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian51(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian51_result;
-   psi_hessian51_result = 2*C*(f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f21 + f01*f20)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian51_result;
+   psi_hessian51_result = 2*C*(f20/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f20*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f21 + f01*f20)*(-f10*f22 + f12*f20);
    return psi_hessian51_result;
 
 }
 
 
-float psi_hessian52(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian52(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian52_result;
-   psi_hessian52_result = -2*C*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian52_result;
+   psi_hessian52_result = -2*C*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f21 + f01*f20)*(-f10*f21 + f11*f20);
    return psi_hessian52_result;
 
 }
 
 
-float psi_hessian53(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian53(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian53_result;
-   psi_hessian53_result = 2*C*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian53_result;
+   psi_hessian53_result = 2*C*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f21 + f01*f20)*(-f01*f22 + f02*f21);
    return psi_hessian53_result;
 
 }
 
 
-float psi_hessian54(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian54(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian54_result;
-   psi_hessian54_result = -2*C*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian54_result;
+   psi_hessian54_result = -2*C*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f21 + f01*f20)*(-f00*f22 + f02*f20);
    return psi_hessian54_result;
 
 }
 
 
-float psi_hessian55(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian55(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian55_result;
-   psi_hessian55_result = 2*C*(pow(-f00*f21 + f01*f20, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f00*f21 + f01*f20, 2);
+   Scalar psi_hessian55_result;
+   psi_hessian55_result = 2*C*(std::pow(-f00*f21 + f01*f20, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f00*f21 + f01*f20, Scalar(2));
    return psi_hessian55_result;
 
 }
 
 
-float psi_hessian56(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian56(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian56_result;
-   psi_hessian56_result = -2*C*(-f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian56_result;
+   psi_hessian56_result = -2*C*(-f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f01*f12 + f02*f11);
    return psi_hessian56_result;
 
 }
 
 
-float psi_hessian57(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian57(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian57_result;
-   psi_hessian57_result = 2*C*(-f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f00*f21 + f01*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f00*f21 + f01*f20);
+   Scalar psi_hessian57_result;
+   psi_hessian57_result = 2*C*(-f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f00*f21 + f01*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f00*f21 + f01*f20);
    return psi_hessian57_result;
 
 }
 
 
-float psi_hessian58(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian58(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian58_result;
-   psi_hessian58_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20);
+   Scalar psi_hessian58_result;
+   psi_hessian58_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20);
    return psi_hessian58_result;
 
 }
 
 
-float psi_hessian60(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian60(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian60_result;
-   psi_hessian60_result = 2*C*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian60_result;
+   psi_hessian60_result = 2*C*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f01*f12 + f02*f11)*(-f11*f22 + f12*f21);
    return psi_hessian60_result;
 
 }
 
 
-float psi_hessian61(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian61(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian61_result;
-   psi_hessian61_result = -2*C*(-f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f12 + f02*f11)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian61_result;
+   psi_hessian61_result = -2*C*(-f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f01*f12 + f02*f11)*(-f10*f22 + f12*f20);
    return psi_hessian61_result;
 
 }
 
 
-float psi_hessian62(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian62(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian62_result;
-   psi_hessian62_result = 2*C*(-f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f12 + f02*f11)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian62_result;
+   psi_hessian62_result = 2*C*(-f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f01*f12 + f02*f11)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f01*f12 + f02*f11)*(-f10*f21 + f11*f20);
    return psi_hessian62_result;
 
 }
 
 
-float psi_hessian63(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian63(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian63_result;
-   psi_hessian63_result = -2*C*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian63_result;
+   psi_hessian63_result = -2*C*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f01*f12 + f02*f11)*(-f01*f22 + f02*f21);
    return psi_hessian63_result;
 
 }
 
 
-float psi_hessian64(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian64(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian64_result;
-   psi_hessian64_result = 2*C*(-f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian64_result;
+   psi_hessian64_result = 2*C*(-f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f22 + f02*f20)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f22 + f02*f20)*(-f01*f12 + f02*f11);
    return psi_hessian64_result;
 
 }
 
 
-float psi_hessian65(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian65(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian65_result;
-   psi_hessian65_result = -2*C*(-f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian65_result;
+   psi_hessian65_result = -2*C*(-f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f21 + f01*f20)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f21 + f01*f20)*(-f01*f12 + f02*f11);
    return psi_hessian65_result;
 
 }
 
 
-float psi_hessian66(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian66(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian66_result;
-   psi_hessian66_result = 2*C*(pow(-f01*f12 + f02*f11, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f01*f12 + f02*f11, 2);
+   Scalar psi_hessian66_result;
+   psi_hessian66_result = 2*C*(std::pow(-f01*f12 + f02*f11, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f01*f12 + f02*f11, Scalar(2));
    return psi_hessian66_result;
 
 }
 
 
-float psi_hessian67(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian67(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian67_result;
-   psi_hessian67_result = -2*C*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian67_result;
+   psi_hessian67_result = -2*C*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11);
    return psi_hessian67_result;
 
 }
 
 
-float psi_hessian68(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian68(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian68_result;
-   psi_hessian68_result = 2*C*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian68_result;
+   psi_hessian68_result = 2*C*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11);
    return psi_hessian68_result;
 
 }
 
 
-float psi_hessian70(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian70(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian70_result;
-   psi_hessian70_result = -2*C*(f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian70_result;
+   psi_hessian70_result = -2*C*(f12/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f12*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f11*f22 + f12*f21);
    return psi_hessian70_result;
 
 }
 
 
-float psi_hessian71(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian71(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian71_result;
-   psi_hessian71_result = 2*C*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian71_result;
+   psi_hessian71_result = 2*C*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f12 + f02*f10)*(-f10*f22 + f12*f20);
    return psi_hessian71_result;
 
 }
 
 
-float psi_hessian72(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian72(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian72_result;
-   psi_hessian72_result = -2*C*(-f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian72_result;
+   psi_hessian72_result = -2*C*(-f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f12 + f02*f10)*(-f10*f21 + f11*f20);
    return psi_hessian72_result;
 
 }
 
 
-float psi_hessian73(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian73(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian73_result;
-   psi_hessian73_result = 2*C*(f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian73_result;
+   psi_hessian73_result = 2*C*(f02/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f02*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f01*f22 + f02*f21);
    return psi_hessian73_result;
 
 }
 
 
-float psi_hessian74(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian74(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian74_result;
-   psi_hessian74_result = -2*C*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian74_result;
+   psi_hessian74_result = -2*C*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f12 + f02*f10)*(-f00*f22 + f02*f20);
    return psi_hessian74_result;
 
 }
 
 
-float psi_hessian75(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian75(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian75_result;
-   psi_hessian75_result = 2*C*(-f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f00*f21 + f01*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f00*f21 + f01*f20);
+   Scalar psi_hessian75_result;
+   psi_hessian75_result = 2*C*(-f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f12 + f02*f10)*(-f00*f21 + f01*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f12 + f02*f10)*(-f00*f21 + f01*f20);
    return psi_hessian75_result;
 
 }
 
 
-float psi_hessian76(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian76(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian76_result;
-   psi_hessian76_result = -2*C*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian76_result;
+   psi_hessian76_result = -2*C*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f12 + f02*f10)*(-f01*f12 + f02*f11);
    return psi_hessian76_result;
 
 }
 
 
-float psi_hessian77(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian77(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian77_result;
-   psi_hessian77_result = 2*C*(pow(-f00*f12 + f02*f10, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f00*f12 + f02*f10, 2);
+   Scalar psi_hessian77_result;
+   psi_hessian77_result = 2*C*(std::pow(-f00*f12 + f02*f10, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f00*f12 + f02*f10, Scalar(2));
    return psi_hessian77_result;
 
 }
 
 
-float psi_hessian78(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian78(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian78_result;
-   psi_hessian78_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10);
+   Scalar psi_hessian78_result;
+   psi_hessian78_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10);
    return psi_hessian78_result;
 
 }
 
 
-float psi_hessian80(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian80(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian80_result;
-   psi_hessian80_result = 2*C*(f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f11*f22 + f12*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f11*f22 + f12*f21);
+   Scalar psi_hessian80_result;
+   psi_hessian80_result = 2*C*(f11/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f11*f22 + f12*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f11*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f11*f22 + f12*f21);
    return psi_hessian80_result;
 
 }
 
 
-float psi_hessian81(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian81(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian81_result;
-   psi_hessian81_result = -2*C*(f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f10*f22 + f12*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f10*f22 + f12*f20);
+   Scalar psi_hessian81_result;
+   psi_hessian81_result = -2*C*(f10/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f10*f22 + f12*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f10*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f10*f22 + f12*f20);
    return psi_hessian81_result;
 
 }
 
 
-float psi_hessian82(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian82(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian82_result;
-   psi_hessian82_result = 2*C*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20);
+   Scalar psi_hessian82_result;
+   psi_hessian82_result = 2*C*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f11 + f01*f10)*(-f10*f21 + f11*f20);
    return psi_hessian82_result;
 
 }
 
 
-float psi_hessian83(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian83(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian83_result;
-   psi_hessian83_result = -2*C*(f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f01*f22 + f02*f21)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) + 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f01*f22 + f02*f21);
+   Scalar psi_hessian83_result;
+   psi_hessian83_result = -2*C*(f01/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f01*f22 + f02*f21)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) + 2*D*f01*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) - 2*D*(-f00*f11 + f01*f10)*(-f01*f22 + f02*f21);
    return psi_hessian83_result;
 
 }
 
 
-float psi_hessian84(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian84(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian84_result;
-   psi_hessian84_result = 2*C*(f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f00*f22 + f02*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2)) - 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f00*f22 + f02*f20);
+   Scalar psi_hessian84_result;
+   psi_hessian84_result = 2*C*(f00/(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11)) + (-f00*f11 + f01*f10)*(-f00*f22 + f02*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2))) - 2*D*f00*(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11) + 1) + 2*D*(-f00*f11 + f01*f10)*(-f00*f22 + f02*f20);
    return psi_hessian84_result;
 
 }
 
 
-float psi_hessian85(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian85(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian85_result;
-   psi_hessian85_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20);
+   Scalar psi_hessian85_result;
+   psi_hessian85_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f11 + f01*f10)*(-f00*f21 + f01*f20);
    return psi_hessian85_result;
 
 }
 
 
-float psi_hessian86(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian86(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian86_result;
-   psi_hessian86_result = 2*C*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 2*D*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11);
+   Scalar psi_hessian86_result;
+   psi_hessian86_result = 2*C*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 2*D*(-f00*f11 + f01*f10)*(-f01*f12 + f02*f11);
    return psi_hessian86_result;
 
 }
 
 
-float psi_hessian87(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian87(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian87_result;
-   psi_hessian87_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) - 2*D*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10);
+   Scalar psi_hessian87_result;
+   psi_hessian87_result = -2*C*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10)/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) - 2*D*(-f00*f11 + f01*f10)*(-f00*f12 + f02*f10);
    return psi_hessian87_result;
 
 }
 
 
-float psi_hessian88(float C, float D, float f00, float f01, float f02, float f10, float f11, float f12, float f20, float f21, float f22) {
+template<typename Scalar>
+Scalar psi_hessian88(Scalar C, Scalar D, Scalar f00, Scalar f01, Scalar f02, Scalar f10, Scalar f11, Scalar f12, Scalar f20, Scalar f21, Scalar f22) {
 
-   float psi_hessian88_result;
-   psi_hessian88_result = 2*C*(pow(-f00*f11 + f01*f10, 2)/pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), 2) + 1) + 2*D*pow(-f00*f11 + f01*f10, 2);
+   Scalar psi_hessian88_result;
+   psi_hessian88_result = 2*C*(std::pow(-f00*f11 + f01*f10, Scalar(2))/std::pow(f00*(-f11*f22 + f12*f21) - f10*(-f01*f22 + f02*f21) + f20*(-f01*f12 + f02*f11), Scalar(2)) + 1) + 2*D*std::pow(-f00*f11 + f01*f10, Scalar(2));
    return psi_hessian88_result;
 
 }
 
-Eigen::MatrixXf psi_hessian(float C, float D, Eigen::VectorXf f) {
-    Eigen::MatrixXf psi_hess = Eigen::MatrixXf::Zero(9,9);
+template<typename Scalar>
+Matrix9<Scalar> psi_hessian(Scalar C, Scalar D, const Vector9<Scalar> &f) {
+    Matrix9<Scalar> psi_hess;
     
     psi_hess(0,0) = psi_hessian00(C, D, f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8]);
     psi_hess(0,1) = psi_hessian01(C, D, f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8]);
@@ -3,7 +3,8 @@
 #include <iostream>
 #include "../utils/camera.h"
 #include "../utils/shader.h"
-#include "../utils/draw_shapes.h"
+#include "../utils/render_mesh.h"
+#include "../utils/vertex_normals.h"
 #include "../utils/RootDir.h"
 #include "./physics.h"
 #include <fstream>
@@ -111,7 +112,14 @@ int main(int argc, const char * argv[]) {
     
     TetrahedralMesh tetMesh(path_prefix + "mesh/bunny_tet.msh");
     Mesh skinMesh(path_prefix + "mesh/bunny.obj");
-    PhysicalMesh pm = PhysicalMesh(tetMesh, skinMesh);
+    // Distance field of the displaced cube, computed on the first run and cached next to the mesh.
+    SignedDistanceField cubeField(cubeMesh, 0.1f, path_prefix + "mesh/big_cube.sdf");
+    PhysicalMeshf pm(tetMesh, skinMesh, MassMatrix::Lumped);
+    pm.setIntegrator(Integrator::VelocityVerlet);
+    pm.addObstacle(cubeField);
+    // Skin mesh buffer updated in place every frame.
+    Mesh updatedMesh = pm.getSkinMesh();
+    VertexNormals bunnyNormals(updatedMesh);
     
     unsigned int bunnyVAO, bunnyVBO = 0;
     unsigned int cubeVAO, cubeVBO = 0;
@@ -129,8 +137,13 @@ int main(int argc, const char * argv[]) {
         glClear(GL_COLOR_BUFFER_BIT);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        pm.simulationStep();
-        Mesh updatedMesh = pm.getSkinMesh();
+        // Simulated time per frame is fixed, the substeps are chosen by the time step controller.
+        pm.advance(1.0f/60);
+#ifdef COUNT_ALLOCATIONS
+        std::cout << "Heap allocations in step: " << pm.getLastStepAllocations() << std::endl;
+#endif
+        pm.updateSkinPositions(updatedMesh.positions);
+        bunnyNormals.update(updatedMesh);
         
         pbrShader.use();
         Eigen::Matrix4f view = camera.GetViewMatrix();
@@ -0,0 +1,294 @@
+#ifndef materials_h
+#define materials_h
+
+#include <Eigen/Dense>
+#include <Eigen/SVD>
+#include <cmath>
+#include <limits>
+#include "types.h"
+#include "neo_hookean.h"
+#include "batched_forces.h"
+
+/**
+ * Constitutive models, the Material policy of PhysicalMesh. Every model has Lame parameters mu and lambda and
+ * evaluates its energy density psi, the gradient and the Hessian with respect to the flattened deformation gradient
+ * f = (F00, F01, F02, F10, ..., F22). Pass nullptr for the values that are not needed.
+ * Default parameters are the neo-hookean C = 170, D = 169.5 (mu = 2*C, lambda = 2*D), all models agree near rest.
+ * Models with a SIMD force kernel set batched, models whose element stiffness is the rest one rotated by the
+ * element rotation set constantStiffness. name() tells models apart in cache keys, their defaults are the same.
+ */
+
+// Closest rotation to F, rather than reflection for inverted tetrahedra.
+// Scaled Newton iteration R = (g*R + R^-T/g)/2 on the polar decomposition, which converges in a few steps
+// for F with positive determinant, SVD only for inverted and degenerate tetrahedra.
+template<typename Scalar>
+Eigen::Matrix<Scalar, 3, 3> closestRotation(const Eigen::Matrix<Scalar, 3, 3> &F) {
+    const Scalar tolerance = 16*std::numeric_limits<Scalar>::epsilon();
+    if (F.determinant() > tolerance*F.squaredNorm()*F.norm()) {
+        Eigen::Matrix<Scalar, 3, 3> R = F;
+        for (int k = 0; k<20; k++) {
+            // R^-T is the cofactor matrix over the determinant.
+            Eigen::Matrix<Scalar, 3, 3> inverseT;
+            inverseT.col(0) = R.col(1).cross(R.col(2));
+            inverseT.col(1) = R.col(2).cross(R.col(0));
+            inverseT.col(2) = R.col(0).cross(R.col(1));
+            inverseT *= 1/R.col(0).dot(inverseT.col(0));
+            Scalar g = std::sqrt(std::sqrt(inverseT.squaredNorm()/R.squaredNorm()));
+            Eigen::Matrix<Scalar, 3, 3> next = Scalar(0.5)*g*R + (Scalar(0.5)/g)*inverseT;
+            Scalar change = (next - R).squaredNorm();
+            R = next;
+            if (change < tolerance*tolerance) {
+                break;
+            }
+        }
+        return R;
+    }
+    Eigen::JacobiSVD<Eigen::Matrix<Scalar, 3, 3>> svd(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Matrix<Scalar, 3, 3> U = svd.matrixU();
+    if ((U*svd.matrixV().transpose()).determinant() < 0) {
+        U.col(2) = -U.col(2);
+    }
+    return U*svd.matrixV().transpose();
+}
+
+// Updates rotation, a unit quaternion, to the closest rotation to F when it is close to it already, e.g. the
+// rotation of the tetrahedron at its previous evaluation, and returns it as a matrix. Newton's method maximizes
+// tr(R^T F) over R*exp(w): with S = R^T F the gradient is the axial vector of S - S^T and the Hessian
+// tr(S)*I - (S + S^T)/2, so one or two 3x3 solves replace the polar decomposition. Far from the maximum, where the
+// Hessian isn't positive definite, the polar decomposition takes over.
+template<typename Scalar>
+Eigen::Matrix<Scalar, 3, 3> updateRotation(const Eigen::Matrix<Scalar, 3, 3> &F, Eigen::Quaternion<Scalar> &rotation) {
+    typedef Eigen::Matrix<Scalar, 3, 3> Matrix3;
+    // Steps shrink quadratically, the one after a step below tolerance is below machine precision.
+    const Scalar tolerance = std::sqrt(std::numeric_limits<Scalar>::epsilon());
+    Matrix3 R = rotation.toRotationMatrix();
+    for (int k = 0; k<4; k++) {
+        Matrix3 S = R.transpose()*F;
+        Eigen::Matrix<Scalar, 3, 1> g(S(2, 1) - S(1, 2), S(0, 2) - S(2, 0), S(1, 0) - S(0, 1));
+        Matrix3 H = S.trace()*Matrix3::Identity() - Scalar(0.5)*(S + S.transpose());
+        // Adjugate of H, which is positive definite when its leading minors and its determinant are positive.
+        Matrix3 adjugate;
+        adjugate.col(0) = H.col(1).cross(H.col(2));
+        adjugate.col(1) = H.col(2).cross(H.col(0));
+        adjugate.col(2) = H.col(0).cross(H.col(1));
+        Scalar determinant = H.col(0).dot(adjugate.col(0));
+        if (!(H(0, 0) > 0 && adjugate(2, 2) > 0 && determinant > 0)) {
+            break;
+        }
+        Eigen::Matrix<Scalar, 3, 1> w = adjugate*g/determinant;
+        if (!(w.squaredNorm() < Scalar(0.25))) {
+            break;
+        }
+        // exp(w) to second order, normalized.
+        rotation = rotation*Eigen::Quaternion<Scalar>(1, w[0]/2, w[1]/2, w[2]/2);
+        rotation.normalize();
+        if (w.squaredNorm() < tolerance*tolerance) {
+            // R*exp(w) to first order is exact up to |w|^2, below machine precision.
+            Matrix3 Rw;
+            Rw.col(0) = R.col(1)*w[2] - R.col(2)*w[1];
+            Rw.col(1) = R.col(2)*w[0] - R.col(0)*w[2];
+            Rw.col(2) = R.col(0)*w[1] - R.col(1)*w[0];
+            return R + Rw;
+        }
+        R = rotation.toRotationMatrix();
+    }
+    R = closestRotation<Scalar>(F);
+    rotation = Eigen::Quaternion<Scalar>(R);
+    return R;
+}
+
+// psi = mu/2*(tr(F^T F) - 3) - mu*log(J) + lambda/2*(J - 1)^2, infinite resistance to inversion.
+template<typename Scalar>
+struct NeoHookean {
+    static const bool batched = true;
+    static const bool constantStiffness = false;
+    Scalar mu = 340;
+    Scalar lambda = 339;
+
+    static const char *name() {
+        return "neo-hookean";
+    }
+
+    void evaluate(const Vector9<Scalar> &f, Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) const {
+        neoHookean<Scalar>(mu/2, lambda/2, f, psi, grad, hess);
+    }
+};
+
+// Saint Venant-Kirchhoff model psi = mu*|E|^2 + lambda/2*tr(E)^2 with the Green strain E = (F^T F - I)/2.
+// Cheaper than neo-hookean, but it softens under strong compression and doesn't resist inversion.
+template<typename Scalar>
+struct StVenantKirchhoff {
+    static const bool batched = false;
+    static const bool constantStiffness = false;
+    Scalar mu = 340;
+    Scalar lambda = 339;
+
+    static const char *name() {
+        return "StVK";
+    }
+
+    void evaluate(const Vector9<Scalar> &f, Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) const {
+        typedef Eigen::Matrix<Scalar, 3, 3> Matrix3;
+        typedef Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor> RowMatrix3;
+        Eigen::Map<const RowMatrix3> F(f.data());
+        Matrix3 E = (F.transpose()*F - Matrix3::Identity())/2;
+        Scalar trE = E.trace();
+        // Second Piola-Kirchhoff stress, the gradient is F*S.
+        Matrix3 S = 2*mu*E + lambda*trE*Matrix3::Identity();
+        if (psi != nullptr) {
+            *psi = mu*E.squaredNorm() + lambda/2*trE*trE;
+        }
+        if (grad != nullptr) {
+            Eigen::Map<RowMatrix3>(grad->data()) = F*S;
+        }
+        if (hess != nullptr) {
+            // Column k is the change of F*S for a unit change of k-th entry of F.
+            for (int k = 0; k<9; k++) {
+                Matrix3 dF = Matrix3::Zero();
+                dF(k/3, k%3) = 1;
+                Matrix3 dE = (dF.transpose()*F + F.transpose()*dF)/2;
+                Matrix3 dS = 2*mu*dE + lambda*dE.trace()*Matrix3::Identity();
+                Eigen::Map<RowMatrix3>(hess->col(k).data()) = dF*S + F*dS;
+            }
+        }
+    }
+};
+
+// Corotated linear model psi = mu*|F - R|^2 + lambda/2*tr(R^T F - I)^2, linear elasticity in the frame of
+// the closest rotation R of F. The gradient is exact, the Hessian leaves out the change of R: it is the rest
+// Hessian rotated by R, dF -> mu*(dF + R*dF^T*R) + lambda*tr(R^T dF)*R, positive semidefinite and zero for rotations.
+template<typename Scalar>
+struct CorotatedLinear {
+    static const bool batched = true;
+    static const bool constantStiffness = true;
+    Scalar mu = 340;
+    Scalar lambda = 339;
+
+    static const char *name() {
+        return "corotated linear";
+    }
+
+    void evaluate(const Vector9<Scalar> &f, Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) const {
+        evaluate(f, closestRotation<Scalar>(Eigen::Map<const Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data())), psi, grad, hess);
+    }
+
+    // Same with the closest rotation R to F known.
+    void evaluate(const Vector9<Scalar> &f, const Eigen::Matrix<Scalar, 3, 3> &R, Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) const {
+        Vector9<Scalar> r;
+        Eigen::Map<Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(r.data()) = R;
+        // tr(R^T F) - 3, the volume change to first order.
+        Scalar stretch = r.dot(f) - 3;
+        if (psi != nullptr) {
+            *psi = mu*(f - r).squaredNorm() + lambda/2*stretch*stretch;
+        }
+        if (grad != nullptr) {
+            *grad = 2*mu*(f - r) + lambda*stretch*r;
+        }
+        if (hess != nullptr) {
+            *hess = lambda*r*r.transpose();
+            hess->diagonal().array() += mu;
+            // Column k of dF -> R*dF^T*R for dF with the only nonzero entry (k/3, k%3).
+            for (int k = 0; k<9; k++) {
+                Eigen::Map<Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>> column(hess->col(k).data());
+                column.noalias() += mu*R.col(k%3)*R.row(k/3);
+            }
+        }
+    }
+};
+
+// Stiffness matrix volume*B^T*H*B of a tetrahedron at the flattened deformation gradient f.
+template<typename Material, typename Scalar>
+Matrix12<Scalar> elementStiffness(const Material &material, const TetElement<Scalar> &element, const Vector9<Scalar> &f) {
+    Matrix9<Scalar> hessian;
+    material.evaluate(f, nullptr, nullptr, &hessian);
+    Matrix9x12<Scalar> B = element.B();
+    return element.volume*B.transpose()*hessian*B;
+}
+
+// Corotated stiffness without forming B, with g_j the columns of R*D^T the block of vertices j, k is
+// mu*(D*D^T)_jk*I + mu*g_k*g_j^T + lambda*g_j*g_k^T.
+template<typename Scalar>
+Matrix12<Scalar> elementStiffness(const CorotatedLinear<Scalar> &material, const TetElement<Scalar> &element, const Vector9<Scalar> &f) {
+    Eigen::Matrix<Scalar, 3, 3> R = closestRotation<Scalar>(Eigen::Map<const Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data()));
+    Matrix3x4<Scalar> G = R*element.D.transpose();
+    Eigen::Map<const Vector12<Scalar>> g(G.data());
+    Eigen::Matrix<Scalar, 4, 4> DDt = element.D*element.D.transpose();
+    Matrix12<Scalar> K = material.lambda*g*g.transpose();
+    for (int j = 0; j<4; j++) {
+        for (int k = 0; k<4; k++) {
+            K.template block<3,3>(3*j, 3*k).noalias() += material.mu*G.col(k)*G.col(j).transpose();
+            K.template block<3,3>(3*j, 3*k).diagonal().array() += material.mu*DDt(j, k);
+        }
+    }
+    return element.volume*K;
+}
+
+// Energy density and derivatives of a tetrahedron whose rotation is kept between evaluations. Models built on the
+// rotation update it from its last value instead of decomposing F, the others ignore it.
+template<typename Material, typename Scalar>
+void evaluateElement(const Material &material, const Vector9<Scalar> &f, Eigen::Quaternion<Scalar> &/*rotation*/,
+                     Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) {
+    material.evaluate(f, psi, grad, hess);
+}
+
+template<typename Scalar>
+void evaluateElement(const CorotatedLinear<Scalar> &material, const Vector9<Scalar> &f, Eigen::Quaternion<Scalar> &rotation,
+                     Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) {
+    material.evaluate(f, updateRotation<Scalar>(Eigen::Map<const Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data()), rotation),
+                      psi, grad, hess);
+}
+
+// Stiffness of a tetrahedron whose rotation is kept between evaluations. restStiffness is its stiffness at rest
+// for constantStiffness models, the others ignore it.
+template<typename Material, typename Scalar>
+Matrix12<Scalar> elementStiffness(const Material &material, const TetElement<Scalar> &element, const Vector9<Scalar> &f,
+                                  Eigen::Quaternion<Scalar> &/*rotation*/, const Matrix12<Scalar> &/*restStiffness*/) {
+    return elementStiffness(material, element, f);
+}
+
+// Corotated stiffness is the rest one with 3x3 blocks R*K_jk*R^T, symmetric blocks are rotated once.
+template<typename Scalar>
+Matrix12<Scalar> elementStiffness(const CorotatedLinear<Scalar> &/*material*/, const TetElement<Scalar> &/*element*/,
+                                  const Vector9<Scalar> &f, Eigen::Quaternion<Scalar> &rotation, const Matrix12<Scalar> &restStiffness) {
+    Eigen::Matrix<Scalar, 3, 3> R = updateRotation<Scalar>(Eigen::Map<const Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data()), rotation);
+    Matrix12<Scalar> K;
+    for (int k = 0; k<4; k++) {
+        for (int j = k; j<4; j++) {
+            K.template block<3,3>(3*j, 3*k).noalias() = R*restStiffness.template block<3,3>(3*j, 3*k)*R.transpose();
+            if (j != k) {
+                K.template block<3,3>(3*k, 3*j) = K.template block<3,3>(3*j, 3*k).transpose();
+            }
+        }
+    }
+    return K;
+}
+
+// Forces of chunk c of batched tetrahedra, only called for batched models.
+template<typename Material, typename Scalar>
+void evaluateBatch(const Material &/*material*/, BatchedElementForces<Scalar> &/*forces*/, long /*c*/) {
+}
+
+template<typename Scalar>
+void evaluateBatch(const NeoHookean<Scalar> &material, BatchedElementForces<Scalar> &forces, long c) {
+    forces.evaluate(material.mu/2, material.lambda/2, c);
+}
+
+// Tetrahedra whose rotation moved too far for the one step of the kernel finish the update one by one.
+template<typename Scalar>
+void evaluateBatch(const CorotatedLinear<Scalar> &material, BatchedElementForces<Scalar> &forces, long c) {
+    forces.evaluateCorotated(material.mu, material.lambda, c);
+    long begin = c*BatchedElementForces<Scalar>::chunkSize;
+    for (long i = begin; i<begin + BatchedElementForces<Scalar>::chunkSize; i++) {
+        if (!forces.converged(i)) {
+            Vector9<Scalar> f = forces.deformationGradient(i);
+            Eigen::Quaternion<Scalar> rotation = forces.rotation(i);
+            Vector9<Scalar> P;
+            material.evaluate(f, updateRotation<Scalar>(Eigen::Map<const Eigen::Matrix<Scalar, 3, 3, Eigen::RowMajor>>(f.data()), rotation),
+                              nullptr, &P, nullptr);
+            forces.setRotation(i, rotation);
+            forces.setStress(i, P);
+        }
+    }
+}
+
+#endif /* materials_h */
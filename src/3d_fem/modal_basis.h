@@ -0,0 +1,164 @@
+#ifndef modal_basis_h
+#define modal_basis_h
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <random>
+#include <math.h>
+
+/**
+ * Lowest vibration modes of a sparse stiffness matrix K against a mass matrix M, K*u = lambda*M*u.
+ * Shift-invert block Lanczos: K - shift*M is factorized once, the shift is below 0 so that rigid motions of a free
+ * body are found as well, and the largest eigenvalues 1/(lambda - shift) of (K - shift*M)^-1*M are found on a Krylov
+ * space kept M-orthonormal by full reorthogonalization. Blocks of several vectors find repeated eigenvalues (a free
+ * body has 6 rigid modes with lambda = 0). The space grows by a block until the requested modes converge.
+ */
+template<typename Scalar>
+class ModalBasis {
+
+private:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::SparseMatrix<Scalar> SparseMatrix;
+
+    SparseMatrix M;
+    Scalar shift = 0;
+    Eigen::SimplicialLDLT<SparseMatrix> shiftedSolver;
+
+    // Makes columns from..end of V M-orthonormal to all columns before them. Columns that are (nearly) dependent
+    // are replaced with random vectors, there are always enough of them while V has fewer columns than rows.
+    void orthonormalize(MatrixX &V, long from, std::mt19937 &random) {
+        std::normal_distribution<double> normal;
+        for (long c = from; c<V.cols(); c++) {
+            for (int attempt = 0; attempt<4; attempt++) {
+                Scalar initial = std::sqrt(V.col(c).dot(M*V.col(c)));
+                // Twice is enough to orthogonalize in floating point.
+                for (int pass = 0; pass<2; pass++) {
+                    VectorX Mv = M*V.col(c);
+                    V.col(c) -= V.leftCols(c)*(V.leftCols(c).transpose()*Mv);
+                }
+                Scalar norm = std::sqrt(V.col(c).dot(M*V.col(c)));
+                if (norm > Scalar(1e-8)*initial) {
+                    V.col(c) /= norm;
+                    break;
+                }
+                for (long i = 0; i<V.rows(); i++) {
+                    V(i, c) = (Scalar)normal(random);
+                }
+            }
+        }
+    }
+
+public:
+    // M-orthonormal columns, modes^T*M*modes = I. The first eigenvalues.size() are vibration modes with
+    // modes^T*K*modes = diag(eigenvalues), lowest first, added vectors follow.
+    MatrixX modes;
+    VectorX eigenvalues;
+    // Krylov space size of the last computation and the largest residual |A*u - theta*u|_M/theta of its modes.
+    long spaceSize = 0;
+    Scalar error = 0;
+    bool converged = false;
+
+    // Finds count lowest modes, converged when residuals are below tolerance. Block size should be at least
+    // the largest multiplicity of the modes wanted.
+    void compute(const SparseMatrix &K, const SparseMatrix &mass, int count, Scalar tolerance = 1e-6, int blockSize = 6) {
+        M = mass;
+        converged = false;
+        modes.resize(0, 0);
+        eigenvalues.resize(0);
+        long size = K.rows();
+        count = (int)std::min((long)count, size);
+        blockSize = (int)std::max(1L, std::min((long)blockSize, size));
+        // Small against the mean eigenvalue, K - shift*M stays positive definite for a free body.
+        shift = -Scalar(1e-4)*K.diagonal().sum()/M.diagonal().sum();
+        SparseMatrix shifted = K - shift*M;
+        shiftedSolver.compute(shifted);
+        if (shiftedSolver.info() != Eigen::Success) {
+            return;
+        }
+
+        std::mt19937 random(0);
+        std::normal_distribution<double> normal;
+        MatrixX V(size, blockSize);
+        for (long i = 0; i<size; i++) {
+            for (int c = 0; c<blockSize; c++) {
+                V(i, c) = (Scalar)normal(random);
+            }
+        }
+        orthonormalize(V, 0, random);
+        // A*V with A = (K - shift*M)^-1*M, kept to form the projected matrix and the residuals.
+        MatrixX AV(size, 0);
+        Eigen::SelfAdjointEigenSolver<MatrixX> ritz;
+        // Rayleigh-Ritz costs as much as growing the space, it is done whenever the space has grown by a quarter.
+        long checked = 0;
+        while (true) {
+            long from = AV.cols();
+            AV.conservativeResize(size, V.cols());
+            AV.rightCols(V.cols() - from) = shiftedSolver.solve(M*V.rightCols(V.cols() - from));
+            spaceSize = V.cols();
+
+            bool last = spaceSize + blockSize > size;
+            if (spaceSize >= std::min(size, (long)count + blockSize) && (4*spaceSize >= 5*checked || last)) {
+                checked = spaceSize;
+                // Rayleigh-Ritz on the space, theta is largest for the lowest lambda.
+                MatrixX T = V.transpose()*(M*AV);
+                ritz.compute((T + T.transpose())/2);
+                error = 0;
+                for (int k = 0; k<count; k++) {
+                    long j = spaceSize - 1 - k;
+                    Scalar theta = ritz.eigenvalues()[j];
+                    VectorX residual = AV*ritz.eigenvectors().col(j) - theta*(V*ritz.eigenvectors().col(j));
+                    error = std::max(error, std::sqrt(residual.dot(M*residual))/std::abs(theta));
+                }
+                converged = error <= tolerance;
+                if (converged || last) {
+                    break;
+                }
+            }
+
+            // Next block continues the Krylov sequence from the last one.
+            long next = std::min((long)blockSize, size - spaceSize);
+            V.conservativeResize(size, spaceSize + next);
+            V.rightCols(next) = AV.rightCols(next);
+            orthonormalize(V, spaceSize, random);
+        }
+
+        modes.resize(size, count);
+        eigenvalues.resize(count);
+        for (int k = 0; k<count; k++) {
+            long j = spaceSize - 1 - k;
+            modes.col(k) = V*ritz.eigenvectors().col(j);
+            eigenvalues[k] = shift + 1/ritz.eigenvalues()[j];
+        }
+    }
+
+    // (K - shift*M)^-1*b, which is close to K^-1*b on the part of b orthogonal to rigid motions.
+    VectorX solveShifted(const VectorX &b) {
+        return shiftedSolver.solve(b);
+    }
+
+    // Appends vectors to the basis, M-orthonormal to it. Vectors that add less than dropTolerance of their
+    // M-norm are dropped. Returns the number of columns added.
+    long addVectors(const MatrixX &vectors, Scalar dropTolerance = 1e-4) {
+        long added = 0;
+        for (long c = 0; c<vectors.cols(); c++) {
+            VectorX v = vectors.col(c);
+            Scalar initial = std::sqrt(v.dot(M*v));
+            for (int pass = 0; pass<2; pass++) {
+                VectorX Mv = M*v;
+                v -= modes*(modes.transpose()*Mv);
+            }
+            Scalar norm = std::sqrt(v.dot(M*v));
+            if (!(norm > dropTolerance*initial)) {
+                continue;
+            }
+            modes.conservativeResize(modes.rows(), modes.cols() + 1);
+            modes.col(modes.cols() - 1) = v/norm;
+            added++;
+        }
+        return added;
+    }
+};
+
+#endif /* modal_basis_h */
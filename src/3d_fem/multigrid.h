@@ -0,0 +1,550 @@
+#ifndef multigrid_h
+#define multigrid_h
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "types.h"
+#include "assembly.h"
+#include "tet_grid.h"
+
+/**
+ * Geometric multigrid for symmetric systems of a tetrahedral mesh with 3 coordinates per vertex, e.g. M + h^2*K.
+ * Coarse levels are regular grids of tetrahedra (6 per cube) covering the vertices of the level below, which are
+ * interpolated from the grid tetrahedron containing them with barycentric coordinates, the same way the skin
+ * follows the tetrahedral mesh. Coarse matrices are Galerkin products P^T*A*P, computed block by block in parallel,
+ * smoothing is damped 3x3 block-Jacobi, a parallel loop over vertices, and the coarsest level is factorized.
+ * Matrices of every level store full 3x3 blocks of a vertex as 3 consecutive rows of 3 consecutive columns.
+ */
+template<typename Scalar>
+class Multigrid {
+
+private:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::Matrix<Scalar, 3, 3> Matrix3;
+    typedef Eigen::SparseMatrix<Scalar> SparseMatrix;
+
+    struct Level {
+        long n = 0;
+        // System of this level, coarse levels only, the finest one is the caller's matrix, see system().
+        SparseMatrix A;
+        // Vertex i of this level is interpolated from vertices parents[4*i..4*i + 3] of the next coarser one,
+        // childOffsets and children list the same weights by coarse vertex, so both directions are race free loops.
+        std::vector<int> parents;
+        std::vector<Scalar> parentWeights;
+        std::vector<int> childOffsets;
+        std::vector<int> children;
+        std::vector<Scalar> childWeights;
+        // Inverses of 3x3 diagonal blocks of A, 9 column-major entries per vertex.
+        VectorX blockInverses;
+        // Solution, right hand side and residual of the cycle.
+        VectorX x;
+        VectorX b;
+        VectorX r;
+    };
+
+    std::vector<Level> levels;
+    // Matrix passed to the last update, which outlives the solves that use it.
+    const SparseMatrix *fineA = nullptr;
+    // Pattern of the finest matrix the coarse patterns were built for.
+    std::vector<int> fineOuter;
+    std::vector<int> fineInner;
+    Eigen::SimplicialLDLT<SparseMatrix> coarseSolver;
+    VectorX coarseDiagonalInv;
+    VectorX coarseSolveTmp;
+
+    const SparseMatrix &system(int l) const {
+        return l == 0 ? *fineA : levels[l].A;
+    }
+
+    // Regular grid of cubes with side cellSize over the points, only cubes containing some point are kept and
+    // split into 6 tetrahedra along their main diagonal, which matches on faces shared by neighbouring cubes.
+    static void gridTetrahedra(const VectorX &points, Scalar cellSize, VectorX &gridPositions, std::vector<int> &gridIndices) {
+        long count = points.size()/3;
+        Vector3 lower = Vector3::Constant(std::numeric_limits<Scalar>::max());
+        Vector3 upper = Vector3::Constant(std::numeric_limits<Scalar>::lowest());
+        for (long i = 0; i<count; i++) {
+            lower = lower.cwiseMin(points.template segment<3>(3*i));
+            upper = upper.cwiseMax(points.template segment<3>(3*i));
+        }
+        Eigen::Vector3i dims;
+        for (int k = 0; k<3; k++) {
+            dims[k] = std::max(1, (int)std::ceil((upper[k] - lower[k])/cellSize));
+        }
+        auto cellOf = [&](const Vector3 &p) {
+            Eigen::Vector3i cell;
+            for (int k = 0; k<3; k++) {
+                cell[k] = std::min(std::max((int)std::floor((p[k] - lower[k])/cellSize), 0), dims[k] - 1);
+            }
+            return cell;
+        };
+        std::vector<char> kept((long)dims.prod(), 0);
+        for (long i = 0; i<count; i++) {
+            Eigen::Vector3i cell = cellOf(points.template segment<3>(3*i));
+            kept[(cell[2]*dims[1] + cell[1])*dims[0] + cell[0]] = 1;
+        }
+
+        // Grid vertices of kept cubes, numbered in grid order.
+        Eigen::Vector3i vertexDims = dims.array() + 1;
+        std::vector<int> vertexIndex((long)vertexDims.prod(), -1);
+        auto gridVertex = [&](int x, int y, int z) {
+            return (long)(z*vertexDims[1] + y)*vertexDims[0] + x;
+        };
+        for (int z = 0; z<dims[2]; z++) {
+            for (int y = 0; y<dims[1]; y++) {
+                for (int x = 0; x<dims[0]; x++) {
+                    if (!kept[(z*dims[1] + y)*dims[0] + x]) {
+                        continue;
+                    }
+                    for (int corner = 0; corner<8; corner++) {
+                        vertexIndex[gridVertex(x + (corner & 1), y + (corner >> 1 & 1), z + (corner >> 2))] = 0;
+                    }
+                }
+            }
+        }
+        long gridCount = 0;
+        for (int &index : vertexIndex) {
+            if (index == 0) {
+                index = (int)gridCount++;
+            }
+        }
+        gridPositions.resize(3*gridCount);
+        for (int z = 0; z<vertexDims[2]; z++) {
+            for (int y = 0; y<vertexDims[1]; y++) {
+                for (int x = 0; x<vertexDims[0]; x++) {
+                    int index = vertexIndex[gridVertex(x, y, z)];
+                    if (index >= 0) {
+                        gridPositions.template segment<3>(3*index) = lower + cellSize*Vector3(x, y, z);
+                    }
+                }
+            }
+        }
+
+        // Paths from corner 0 to corner 7 along the 3 axes in every order, each is a tetrahedron.
+        static const int axes[6][3] = {{1, 2, 4}, {1, 4, 2}, {2, 1, 4}, {2, 4, 1}, {4, 1, 2}, {4, 2, 1}};
+        gridIndices.clear();
+        for (int z = 0; z<dims[2]; z++) {
+            for (int y = 0; y<dims[1]; y++) {
+                for (int x = 0; x<dims[0]; x++) {
+                    if (!kept[(z*dims[1] + y)*dims[0] + x]) {
+                        continue;
+                    }
+                    for (const auto &path : axes) {
+                        int corner = 0;
+                        gridIndices.push_back(vertexIndex[gridVertex(x, y, z)]);
+                        for (int step : path) {
+                            corner += step;
+                            gridIndices.push_back(vertexIndex[gridVertex(x + (corner & 1), y + (corner >> 1 & 1), z + (corner >> 2))]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Binds vertices of level l at points to a grid of cubes with side cellSize, adds the coarse level with the
+    // grid vertices that some vertex depends on and returns their positions.
+    VectorX addCoarseLevel(int l, const VectorX &points, Scalar cellSize) {
+        VectorX gridPositions;
+        std::vector<int> gridIndices;
+        gridTetrahedra(points, cellSize, gridPositions, gridIndices);
+        long gridTets = gridIndices.size()/4;
+        AlignedVector<TetElement<Scalar>> gridElements(gridTets);
+        for (long t = 0; t<gridTets; t++) {
+            Matrix3 T;
+            for (int k = 0; k<4; k++) {
+                gridElements[t].indices[k] = gridIndices[4*t + k];
+            }
+            for (int k = 0; k<3; k++) {
+                T.col(k) = gridPositions.template segment<3>(3*gridIndices[4*t + k + 1]) - gridPositions.template segment<3>(3*gridIndices[4*t]);
+            }
+            Matrix3 T_inv = T.inverse();
+            gridElements[t].D.row(0) = -Vector3::Ones().transpose()*T_inv;
+            gridElements[t].D.template bottomRows<3>() = T_inv;
+            gridElements[t].volume = std::abs(T.determinant())/6;
+        }
+
+        Level &fine = levels[l];
+        TetGrid<Scalar> grid(gridElements, gridPositions);
+        fine.parents.resize(4*fine.n);
+        fine.parentWeights.resize(4*fine.n);
+        std::vector<int> used(gridPositions.size()/3, -1);
+        for (long i = 0; i<fine.n; i++) {
+            Vector3 p = points.template segment<3>(3*i);
+            int t = grid.locate(p);
+            Eigen::Matrix<Scalar, 4, 1> weights = grid.barycentric(t, p);
+            for (int k = 0; k<4; k++) {
+                fine.parents[4*i + k] = gridElements[t].indices[k];
+                fine.parentWeights[4*i + k] = weights[k];
+                if (weights[k] != 0) {
+                    used[gridElements[t].indices[k]] = 0;
+                }
+            }
+        }
+
+        // Grid vertices no vertex depends on would make the coarse matrix singular.
+        long coarseCount = 0;
+        for (int &index : used) {
+            if (index == 0) {
+                index = (int)coarseCount++;
+            }
+        }
+        VectorX coarsePositions(3*coarseCount);
+        for (long v = 0; v<(long)used.size(); v++) {
+            if (used[v] >= 0) {
+                coarsePositions.template segment<3>(3*used[v]) = gridPositions.template segment<3>(3*v);
+            }
+        }
+        fine.childOffsets.assign(coarseCount + 1, 0);
+        for (long k = 0; k<4*fine.n; k++) {
+            fine.parents[k] = std::max(used[fine.parents[k]], 0);
+            if (fine.parentWeights[k] != 0) {
+                fine.childOffsets[fine.parents[k] + 1]++;
+            }
+        }
+        for (long c = 0; c<coarseCount; c++) {
+            fine.childOffsets[c + 1] += fine.childOffsets[c];
+        }
+        fine.children.resize(fine.childOffsets[coarseCount]);
+        fine.childWeights.resize(fine.childOffsets[coarseCount]);
+        std::vector<int> fill(fine.childOffsets.begin(), fine.childOffsets.end() - 1);
+        for (long k = 0; k<4*fine.n; k++) {
+            if (fine.parentWeights[k] != 0) {
+                int slot = fill[fine.parents[k]]++;
+                fine.children[slot] = (int)(k/4);
+                fine.childWeights[slot] = fine.parentWeights[k];
+            }
+        }
+
+        Level coarse;
+        coarse.n = coarseCount;
+        levels.push_back(coarse);
+        return coarsePositions;
+    }
+
+    // Sparsity pattern of P^T*A*P of level l into the matrix of level l + 1, with full 3x3 blocks.
+    void buildCoarsePattern(int l) {
+        const Level &fine = levels[l];
+        Level &coarse = levels[l + 1];
+        const int *inner = system(l).innerIndexPtr();
+        const int *outer = system(l).outerIndexPtr();
+        std::vector<std::vector<int>> columns(coarse.n);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+        for (long J = 0; J<coarse.n; J++) {
+            for (int k = fine.childOffsets[J]; k<fine.childOffsets[J + 1]; k++) {
+                int j = fine.children[k];
+                for (int e = outer[3*j]; e<outer[3*j + 1]; e += 3) {
+                    int i = inner[e]/3;
+                    for (int p = 0; p<4; p++) {
+                        if (fine.parentWeights[4*i + p] != 0) {
+                            columns[J].push_back(fine.parents[4*i + p]);
+                        }
+                    }
+                }
+            }
+            std::sort(columns[J].begin(), columns[J].end());
+            columns[J].erase(std::unique(columns[J].begin(), columns[J].end()), columns[J].end());
+        }
+
+        long nonZeros = 0;
+        for (const auto &column : columns) {
+            nonZeros += 9*column.size();
+        }
+        coarse.A.resize(3*coarse.n, 3*coarse.n);
+        coarse.A.resizeNonZeros(nonZeros);
+        int *coarseOuter = coarse.A.outerIndexPtr();
+        int *coarseInner = coarse.A.innerIndexPtr();
+        coarseOuter[0] = 0;
+        for (long J = 0; J<coarse.n; J++) {
+            for (int c = 0; c<3; c++) {
+                int start = coarseOuter[3*J + c];
+                for (int k = 0; k<(int)columns[J].size(); k++) {
+                    for (int r = 0; r<3; r++) {
+                        coarseInner[start + 3*k + r] = 3*columns[J][k] + r;
+                    }
+                }
+                coarseOuter[3*J + c + 1] = start + 3*(int)columns[J].size();
+            }
+        }
+        coarse.A.coeffs().setZero();
+    }
+
+    // Values of the matrix of level l + 1, the coarse pattern holds every block the product adds to.
+    void restrictMatrix(int l) {
+        const Level &fine = levels[l];
+        Level &coarse = levels[l + 1];
+        const Scalar *values = system(l).valuePtr();
+        const int *inner = system(l).innerIndexPtr();
+        const int *outer = system(l).outerIndexPtr();
+        Scalar *coarseValues = coarse.A.valuePtr();
+        const int *coarseInner = coarse.A.innerIndexPtr();
+        const int *coarseOuter = coarse.A.outerIndexPtr();
+        // Coarse block columns are filled by one thread each.
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+        for (long J = 0; J<coarse.n; J++) {
+            std::fill(coarseValues + coarseOuter[3*J], coarseValues + coarseOuter[3*J + 3], Scalar(0));
+            const int *rowsBegin = coarseInner + coarseOuter[3*J];
+            const int *rowsEnd = coarseInner + coarseOuter[3*J + 1];
+            for (int k = fine.childOffsets[J]; k<fine.childOffsets[J + 1]; k++) {
+                int j = fine.children[k];
+                Scalar w_j = fine.childWeights[k];
+                int length = outer[3*j + 1] - outer[3*j];
+                for (int e = 0; e<length; e += 3) {
+                    int i = inner[outer[3*j] + e]/3;
+                    Matrix3 block;
+                    for (int c = 0; c<3; c++) {
+                        block.col(c) = Eigen::Map<const Vector3>(&values[outer[3*j + c] + e]);
+                    }
+                    for (int p = 0; p<4; p++) {
+                        Scalar w = fine.parentWeights[4*i + p]*w_j;
+                        if (w == 0) {
+                            continue;
+                        }
+                        int slot = (int)(std::lower_bound(rowsBegin, rowsEnd, 3*fine.parents[4*i + p]) - rowsBegin);
+                        for (int c = 0; c<3; c++) {
+                            Eigen::Map<Vector3>(&coarseValues[coarseOuter[3*J + c] + slot]) += w*block.col(c);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void invertDiagonalBlocks(int l) {
+        Level &level = levels[l];
+        const Scalar *values = system(l).valuePtr();
+        const int *inner = system(l).innerIndexPtr();
+        const int *outer = system(l).outerIndexPtr();
+        level.blockInverses.resize(9*level.n);
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (long i = 0; i<level.n; i++) {
+            int slot = (int)(std::lower_bound(inner + outer[3*i], inner + outer[3*i + 1], 3*(int)i) - inner);
+            Matrix3 block;
+            for (int c = 0; c<3; c++) {
+                block.col(c) = Eigen::Map<const Vector3>(&values[slot + outer[3*i + c] - outer[3*i]]);
+            }
+            Matrix3 inverse;
+            bool invertible = false;
+            Scalar determinant;
+            block.computeInverseWithCheck(inverse, invertible, determinant);
+            // Indefinite or singular blocks fall back to the diagonal.
+            if (!invertible || inverse.diagonal().minCoeff() <= 0) {
+                inverse = block.diagonal().cwiseAbs().cwiseMax(Scalar(1e-12)).cwiseInverse().asDiagonal();
+            }
+            Eigen::Map<Matrix3>(&level.blockInverses[9*i]) = inverse;
+        }
+    }
+
+    // y = A*x for a symmetric A, row i is column i, so rows are computed in parallel.
+    void multiply(const SparseMatrix &A, const VectorX &x, VectorX &y) {
+        const Scalar *values = A.valuePtr();
+        const int *inner = A.innerIndexPtr();
+        const int *outer = A.outerIndexPtr();
+        long size = A.cols();
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (long col = 0; col<size; col++) {
+            Scalar sum = 0;
+            for (int k = outer[col]; k<outer[col + 1]; k++) {
+                sum += values[k]*x[inner[k]];
+            }
+            y[col] = sum;
+        }
+    }
+
+    // Damped block-Jacobi sweeps x += weight*D^-1*(b - A*x), the first one is cheaper when x starts at 0.
+    void smooth(int l, int sweeps, bool zeroStart) {
+        Level &level = levels[l];
+        for (int s = 0; s<sweeps; s++) {
+            if (s == 0 && zeroStart) {
+                level.r = level.b;
+            } else {
+                multiply(system(l), level.x, level.r);
+                level.r = level.b - level.r;
+            }
+            #pragma omp parallel for num_threads(threads) schedule(static)
+            for (long i = 0; i<level.n; i++) {
+                Vector3 correction = Eigen::Map<const Matrix3>(&level.blockInverses[9*i])*level.r.template segment<3>(3*i);
+                if (s == 0 && zeroStart) {
+                    level.x.template segment<3>(3*i) = smootherWeight*correction;
+                } else {
+                    level.x.template segment<3>(3*i) += smootherWeight*correction;
+                }
+            }
+        }
+    }
+
+    // Approximates the solution of level l from its b into its x, starting from 0.
+    void cycle(int l) {
+        Level &level = levels[l];
+        if (l + 1 == (int)levels.size()) {
+            solveLDLT(coarseSolver, coarseDiagonalInv, level.b, coarseSolveTmp, level.x);
+            return;
+        }
+        smooth(l, smoothingSteps, true);
+        multiply(system(l), level.x, level.r);
+        level.r = level.b - level.r;
+
+        Level &coarse = levels[l + 1];
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (long J = 0; J<coarse.n; J++) {
+            Vector3 sum = Vector3::Zero();
+            for (int k = level.childOffsets[J]; k<level.childOffsets[J + 1]; k++) {
+                sum += level.childWeights[k]*level.r.template segment<3>(3*level.children[k]);
+            }
+            coarse.b.template segment<3>(3*J) = sum;
+        }
+        cycle(l + 1);
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (long i = 0; i<level.n; i++) {
+            for (int p = 0; p<4; p++) {
+                level.x.template segment<3>(3*i) += level.parentWeights[4*i + p]*coarse.x.template segment<3>(3*level.parents[4*i + p]);
+            }
+        }
+        smooth(l, smoothingSteps, false);
+    }
+
+public:
+    // Sweeps before and after the coarse correction and the damping of block-Jacobi.
+    int smoothingSteps = 2;
+    Scalar smootherWeight = 0.6;
+    // Levels are added while the last one has more than coarsestSize vertices, up to maxLevels in total.
+    long coarsestSize = 1000;
+    int maxLevels = 10;
+    int threads = 1;
+    // V-cycles made and relative residual reached by the last solve.
+    int iterations = 0;
+    Scalar error = 0;
+
+    // Builds coarse levels for a mesh with vertices at positions (3 coordinates each) and rest edges of mean length
+    // edgeLength. Every level has about 8 times fewer vertices than the one below, down to coarsestSize.
+    void build(const VectorX &positions, Scalar edgeLength) {
+        levels.clear();
+        fineA = nullptr;
+        fineOuter.clear();
+        fineInner.clear();
+        Level finest;
+        finest.n = positions.size()/3;
+        levels.push_back(finest);
+        VectorX points = positions;
+        // Grids of cubes with side twice the edges of a tetrahedral mesh have about 8 times fewer vertices.
+        Scalar cellSize = 2*edgeLength;
+        while ((int)levels.size()<maxLevels && levels.back().n > coarsestSize) {
+            int l = (int)levels.size() - 1;
+            VectorX coarsePoints = addCoarseLevel(l, points, cellSize);
+            long coarseCount = levels.back().n;
+            if (2*coarseCount > levels[l].n) {
+                // Too little coarsening to pay for another level.
+                levels.pop_back();
+                Level &last = levels.back();
+                last.parents.clear();
+                last.parentWeights.clear();
+                last.childOffsets.clear();
+                last.children.clear();
+                last.childWeights.clear();
+                break;
+            }
+            points = coarsePoints;
+            cellSize *= 2;
+        }
+        for (Level &level : levels) {
+            level.x.setZero(3*level.n);
+            level.b.setZero(3*level.n);
+            level.r.setZero(3*level.n);
+        }
+        coarseSolveTmp.setZero(3*levels.back().n);
+    }
+
+    // Number of levels including the finest one and the vertex count of level l.
+    int getLevelCount() const {
+        return (int)levels.size();
+    }
+
+    long getLevelSize(int l) const {
+        return levels[l].n;
+    }
+
+    // True if A (of the mesh the levels were built for) has another pattern than the one the coarse patterns were built for.
+    bool patternChanged(const SparseMatrix &A) const {
+        return fineOuter.size() != (size_t)A.outerSize() + 1 || fineInner.size() != (size_t)A.nonZeros() ||
+               !std::equal(fineOuter.begin(), fineOuter.end(), A.outerIndexPtr()) ||
+               !std::equal(fineInner.begin(), fineInner.end(), A.innerIndexPtr());
+    }
+
+    // Takes the finest matrix and recomputes the coarse ones, factorize() then factorizes the coarsest. A is kept
+    // by reference, it has to outlive the solves until the next update. Coarse patterns are built on the first call
+    // and whenever the pattern of A changes, only then update allocates.
+    void update(const SparseMatrix &A) {
+        if (levels.empty()) {
+            return;
+        }
+        fineA = &A;
+        bool newPattern = patternChanged(A);
+        for (int l = 0; l + 1<(int)levels.size(); l++) {
+            if (newPattern) {
+                buildCoarsePattern(l);
+            }
+            restrictMatrix(l);
+        }
+        for (int l = 0; l + 1<(int)levels.size(); l++) {
+            invertDiagonalBlocks(l);
+        }
+        if (newPattern) {
+            coarseSolver.analyzePattern(system((int)levels.size() - 1));
+            fineOuter.assign(A.outerIndexPtr(), A.outerIndexPtr() + A.outerSize() + 1);
+            fineInner.assign(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros());
+        }
+    }
+
+    void factorize() {
+        if (levels.empty()) {
+            return;
+        }
+        coarseSolver.factorize(system((int)levels.size() - 1));
+        coarseDiagonalInv = coarseSolver.vectorD().cwiseInverse();
+    }
+
+    bool factorized() const {
+        return coarseSolver.info() == Eigen::Success;
+    }
+
+    // z = one V-cycle applied to r, a symmetric positive definite approximation of A^-1*r.
+    void precondition(const VectorX &r, VectorX &z) {
+        levels[0].b = r;
+        cycle(0);
+        z = levels[0].x;
+    }
+
+    // A*x with the finest matrix.
+    void apply(const VectorX &x, VectorX &y) {
+        multiply(system(0), x, y);
+    }
+
+    // V-cycles on the residual of x until it drops below tolerance times the norm of b.
+    void solve(const VectorX &b, VectorX &x, Scalar tolerance, int maxIterations) {
+        Level &finest = levels[0];
+        iterations = 0;
+        Scalar bNorm = b.norm();
+        if (bNorm == 0) {
+            x.setZero();
+            error = 0;
+            return;
+        }
+        while (true) {
+            multiply(system(0), x, finest.r);
+            finest.b = b - finest.r;
+            error = finest.b.norm()/bNorm;
+            if (error <= tolerance || iterations >= maxIterations) {
+                break;
+            }
+            cycle(0);
+            x += finest.x;
+            iterations++;
+        }
+    }
+};
+
+#endif /* multigrid_h */
@@ -0,0 +1,71 @@
+#ifndef neo_hookean_h
+#define neo_hookean_h
+
+#include <cmath>
+#include <Eigen/Dense>
+#include "types.h"
+
+/**
+ * Neo-hookean density function psi = C*(tr(F^T F) - 2*log(J) - 3) + D*(J - 1)^2, its gradient and Hessian
+ * with respect to the flattened deformation gradient f = (F00, F01, F02, F10, ..., F22).
+ * Determinant J and cofactor matrix of F are computed once and shared by all three.
+ * Pass nullptr for the values that are not needed. Everything is evaluated in the precision of Scalar.
+ * Same functions as in gradient.h and hessian.h, which are kept as a reference that fem_benchmark compares against.
+ */
+template<typename Scalar>
+void neoHookean(Scalar C, Scalar D, const Vector9<Scalar> &f, Scalar *psi, Vector9<Scalar> *grad, Matrix9<Scalar> *hess) {
+    // Cofactor matrix of F flattened the same way as F, it is the derivative of J.
+    Vector9<Scalar> dJ;
+    dJ[0] = f[4]*f[8] - f[5]*f[7];
+    dJ[1] = f[5]*f[6] - f[3]*f[8];
+    dJ[2] = f[3]*f[7] - f[4]*f[6];
+    dJ[3] = f[2]*f[7] - f[1]*f[8];
+    dJ[4] = f[0]*f[8] - f[2]*f[6];
+    dJ[5] = f[1]*f[6] - f[0]*f[7];
+    dJ[6] = f[1]*f[5] - f[2]*f[4];
+    dJ[7] = f[2]*f[3] - f[0]*f[5];
+    dJ[8] = f[0]*f[4] - f[1]*f[3];
+
+    Scalar J = f[0]*dJ[0] + f[1]*dJ[1] + f[2]*dJ[2];
+    Scalar J_inv = 1/J;
+
+    if (psi != nullptr) {
+        *psi = C*(f.squaredNorm() - 2*std::log(J) - 3) + D*(J - 1)*(J - 1);
+    }
+
+    // Coefficient of dJ in the gradient and of the second derivative of J in the Hessian.
+    Scalar a = 2*D*(J - 1) - 2*C*J_inv;
+
+    if (grad != nullptr) {
+        *grad = 2*C*f + a*dJ;
+    }
+
+    if (hess != nullptr) {
+        Scalar b = 2*C*J_inv*J_inv + 2*D;
+        *hess = b*dJ*dJ.transpose();
+        hess->diagonal().array() += 2*C;
+
+        // Second derivative of J: d2J/dF_ij dF_kl = e_ikm * e_jln * F_mn, it is non zero only for i != k and j != l.
+        for (int i = 0; i<3; i++) {
+            for (int k = 0; k<3; k++) {
+                if (i == k) {
+                    continue;
+                }
+                int m = 3 - i - k;
+                Scalar e_ikm = (k == (i + 1)%3) ? 1 : -1;
+                for (int j = 0; j<3; j++) {
+                    for (int l = 0; l<3; l++) {
+                        if (j == l) {
+                            continue;
+                        }
+                        int n = 3 - j - l;
+                        Scalar e_jln = (l == (j + 1)%3) ? 1 : -1;
+                        (*hess)(3*i + j, 3*k + l) += a*e_ikm*e_jln*f[3*m + n];
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif /* neo_hookean_h */
@@ -0,0 +1,92 @@
+#ifndef parallel_h
+#define parallel_h
+
+#include <vector>
+#include <algorithm>
+#include "types.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Ways of evaluating per-tetrahedron loops.
+enum class ElementLoop {
+    // One thread, tetrahedra in mesh order.
+    Serial,
+    // Tetrahedra of the same color share no vertices, so every color is a race free parallel loop.
+    Colored,
+    // Fixed blocks of tetrahedra accumulate into their own buffers which are then summed in block order.
+    Reduction
+};
+
+// Number of threads to use, 0 means the OpenMP default.
+inline int resolveThreadCount(int threads) {
+#ifdef _OPENMP
+    return threads > 0 ? threads : omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Greedy coloring of tetrahedra, no two tetrahedra of the same color share a vertex.
+// Returns a list of tetrahedra indices for every color.
+template<typename Element>
+std::vector<std::vector<int>> colorTetrahedra(unsigned long n, const AlignedVector<Element> &elements) {
+    std::vector<std::vector<int>> colors;
+    // Colors already taken by tetrahedra around each vertex.
+    std::vector<std::vector<int>> vertexColors(n);
+    std::vector<bool> forbidden;
+
+    for (int i = 0; i<elements.size(); i++) {
+        forbidden.assign(colors.size() + 1, false);
+        for (int v : elements[i].indices) {
+            for (int c : vertexColors[v]) {
+                forbidden[c] = true;
+            }
+        }
+        int color = (int)(std::find(forbidden.begin(), forbidden.end(), false) - forbidden.begin());
+        if (color == colors.size()) {
+            colors.push_back(std::vector<int>());
+        }
+        colors[color].push_back(i);
+        for (int v : elements[i].indices) {
+            vertexColors[v].push_back(color);
+        }
+    }
+    return colors;
+}
+
+// Greedy coloring of vertices, no two vertices of the same color belong to the same tetrahedron.
+// Returns a list of vertex indices for every color.
+template<typename Element>
+std::vector<std::vector<int>> colorVertices(unsigned long n, const AlignedVector<Element> &elements) {
+    // Tetrahedra around each vertex.
+    std::vector<std::vector<int>> vertexTets(n);
+    for (int i = 0; i<elements.size(); i++) {
+        for (int v : elements[i].indices) {
+            vertexTets[v].push_back(i);
+        }
+    }
+    
+    std::vector<std::vector<int>> colors;
+    std::vector<int> vertexColor(n, -1);
+    std::vector<bool> forbidden;
+    for (int v = 0; v<n; v++) {
+        forbidden.assign(colors.size() + 1, false);
+        for (int i : vertexTets[v]) {
+            for (int u : elements[i].indices) {
+                if (vertexColor[u] >= 0) {
+                    forbidden[vertexColor[u]] = true;
+                }
+            }
+        }
+        int color = (int)(std::find(forbidden.begin(), forbidden.end(), false) - forbidden.begin());
+        if (color == colors.size()) {
+            colors.push_back(std::vector<int>());
+        }
+        colors[color].push_back(v);
+        vertexColor[v] = color;
+    }
+    return colors;
+}
+
+#endif /* parallel_h */
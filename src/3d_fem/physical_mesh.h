@@ -2,31 +2,165 @@
 #define physical_mesh_h
 
 #include "../utils/draw_shapes.h"
+#include "../utils/alloc_counter.h"
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 #include <tuple>
+#include <random>
+#include <cstdint>
 #include <algorithm>
+#include "types.h"
 #include "gradient.h"
+#include "assembly.h"
+#include "parallel.h"
+#include "batched_forces.h"
+#include "materials.h"
+#include "reordering.h"
+#include "tet_grid.h"
+#include "sdf.h"
+#include "self_collision.h"
+#include "conjugate_gradient.h"
+#include "multigrid.h"
+#include "modal_basis.h"
+#include "cubature.h"
 
 typedef Eigen::SparseMatrix<float> SparseMatrixf;
 typedef Eigen::Triplet<double> T;
 
+// Kinds of the mass matrix.
+enum class MassMatrix {
+    // Consistent mass matrix of linear tetrahedra, solved with a sparse factorization.
+    Consistent,
+    // Diagonal matrix with row sums of the consistent one, inverted per coordinate.
+    Lumped
+};
+
+// Methods of integrating equations of motion.
+enum class Integrator {
+    ForwardEuler,
+    // Explicit kick-drift-kick scheme, second order and symplectic.
+    VelocityVerlet,
+    BackwardEulerLinear,
+    GradientDescent,
+    // Backward Euler solved to convergence with Newton's method and line search.
+    Newton,
+    // Projective Dynamics: fixed number of local projections and global solves with a constant matrix.
+    ProjectiveDynamics,
+    // Vertex block descent: Gauss-Seidel over vertices with a 3x3 Newton step each, no global solve.
+    VertexBlockDescent,
+    // Reduced order backward Euler in the span of the lowest vibration modes (PhysicalMesh::computeModes).
+    Modal
+};
+
+// Ways of solving linear systems M + h^2*K of implicit integrators.
+enum class LinearSolver {
+    // Sparse LDLT factorization of the assembled matrix.
+    Direct,
+    // Preconditioned conjugate gradient applying the matrix tetrahedron by tetrahedron,
+    // the global stiffness matrix is never assembled.
+    MatrixFreeCG,
+    // Geometric multigrid V-cycles on the assembled matrix and a hierarchy of coarse grids (multigrid.h),
+    // iteration counts stay about the same as the mesh is refined.
+    Multigrid,
+    // Conjugate gradient on the assembled matrix with one multigrid V-cycle as the preconditioner.
+    MultigridCG
+};
+
+// Preconditioners of the matrix-free solver.
+enum class Preconditioner {
+    // Inverse of the diagonal.
+    Jacobi,
+    // Inverses of 3x3 diagonal blocks coupling coordinates of the same vertex.
+    BlockJacobi
+};
+
+// Statistics of the last implicit solve.
+struct SolverStats {
+    // Number of Newton iterations made.
+    int iterations = 0;
+    // Conjugate gradient iterations made by all linear solves of the step.
+    int linearIterations = 0;
+    // Norm of the gradient of the implicit Euler energy after every iteration, first is the initial one.
+    std::vector<float> residuals;
+    bool converged = false;
+    // Nonzeros of the factor of the last direct solve.
+    long factorNonZeros = 0;
+};
+
+// What the adaptive time step controller of PhysicalMesh::advance limited a step by.
+enum class TimeStepLimit {
+    // Largest step allowed.
+    MaxStep,
+    // Smallest step allowed, it is taken even if it fails the error criteria.
+    MinStep,
+    // Remaining time of the frame is shorter than the proposed step.
+    FrameEnd,
+    // All criteria were met with margin, steps grow at most twice per step.
+    Growth,
+    // Newton solve didn't reach its tolerance.
+    SolverResidual,
+    // Kinetic plus potential energy grew too much for the kinetic energy around.
+    EnergyDrift,
+    // Some vertex moved too far for the size of its edges.
+    Displacement
+};
+
+std::string timeStepLimitName(TimeStepLimit limit) {
+    switch (limit) {
+        case TimeStepLimit::MaxStep: return "max step";
+        case TimeStepLimit::MinStep: return "min step";
+        case TimeStepLimit::FrameEnd: return "frame end";
+        case TimeStepLimit::Growth: return "growth";
+        case TimeStepLimit::SolverResidual: return "solver residual";
+        case TimeStepLimit::EnergyDrift: return "energy drift";
+        default: return "displacement";
+    }
+}
+
+// Substeps of the last PhysicalMesh::advance call.
+struct TimeStepStats {
+    int substeps = 0;
+    // Substeps that failed the error criteria and were redone with a shorter step.
+    int rejected = 0;
+    // Step of the last accepted substep and why it was chosen.
+    float h = 0;
+    TimeStepLimit limit = TimeStepLimit::MaxStep;
+    // Error estimates of the last accepted substep relative to their tolerances, over 1 fails.
+    float residualError = 0;
+    float energyError = 0;
+    float displacementError = 0;
+};
+
+/**
+ * Tetrahedral mesh simulated with the neo-hookean model. State, accumulation of forces, linear solves and contacts
+ * are in Scalar, element kernels (deformation gradients, energy densities, their derivatives and the rest state of
+ * tetrahedra) in ElementScalar, which is Scalar unless a mixed precision mode is wanted.
+ * Material is the constitutive model (materials.h), its element kernels are inlined into the element loops.
+ */
+template<typename Scalar, typename ElementScalar = Scalar, template<typename> class Material = NeoHookean>
 class PhysicalMesh {
+
+public:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::SparseMatrix<Scalar> SparseMatrix;
     
 private:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, 3, 3> Matrix3;
+    typedef Eigen::Matrix<Scalar, 4, 1> Vector4;
+    typedef TetElement<ElementScalar> Element;
+    typedef Eigen::Matrix<ElementScalar, 3, 3> ElementMatrix3;
+    
     // A 3xn vector of coordinates of all vertices. q = (x0,y0,z0,x1,y1,z1,...)
-    Eigen::VectorXf q;
+    VectorX q;
     // Vector of derivatives of coordinates of all vertices.
-    Eigen::VectorXf q_dot;
-    // List of indices of vertices of terahedra.
-    std::vector<std::vector<int>> tetIndices;
-    // List of volumes of tetrahedra.
-    std::vector<float> volumes;
+    VectorX q_dot;
+    // Vertex indices and rest state of tetrahedra.
+    AlignedVector<Element> elements;
     
-    // Utility matrices for calculating various tetrahedral parameters.
-    std::vector<Eigen::Matrix3f> Ts;
-    std::vector<Eigen::MatrixXf> Bs;
-    std::vector<Eigen::MatrixXf> Ds;
+    // Index in q of every vertex of the mesh file, vertices are reordered for locality on construction.
+    std::vector<int> vertexIndex;
     
     // Number of vertices in a mesh.
     unsigned long n;
@@ -34,81 +168,562 @@ private:
     int long n_tet;
     
     // A 3nx3n mass matrix.
-    SparseMatrixf M;
+    SparseMatrix M;
+    MassMatrix massMatrix;
+    // Inverse of the lumped mass matrix diagonal.
+    VectorX M_lumped_inv;
+    // Factorization of the consistent mass matrix, computed once.
+    Eigen::SimplicialLDLT<SparseMatrix> massSolver;
+    VectorX massSolveTmp;
+    // Inverse of the diagonal factor D of the LDLT factorization of M.
+    VectorX massDiagonalInv;
+    // Assembler of the stiffness matrix with a sparsity pattern fixed by tetrahedra indices.
+    SparseAssembler<Scalar> stiffnessAssembler;
+    
+    // How element loops are evaluated and by how many threads (0 means OpenMP default).
+    ElementLoop elementLoop = ElementLoop::Colored;
+    int threads = 0;
+    // Number of fixed tetrahedra blocks in ElementLoop::Reduction mode.
+    // It doesn't depend on the number of threads, so the summation order doesn't either.
+    int reductionBlocks = 8;
+    // Tetrahedra grouped by colors, tetrahedra of one color don't share vertices.
+    std::vector<std::vector<int>> tetColors;
+    // Per block accumulation buffers of element loops.
+    std::vector<VectorX> gradientBuffers;
+    std::vector<VectorX> hessianBuffers;
+    std::vector<Scalar> tetEnergies;
     
-    // Stiffness parameters.
-    float C = 170;
-    float D = 169.5;
+    // SIMD evaluation of element forces over batches of tetrahedra.
+    BatchedElementForces<ElementScalar> batchedForces;
+    bool useBatchedForces = true;
+    
+    Integrator integrator = Integrator::ForwardEuler;
+    // Time step.
+    Scalar h = 0.001;
+    
+    // Substeps of advance stay within [minTimeStep, maxTimeStep]. A substep is redone with a shorter one if some
+    // vertex moves more than maxDisplacement of its mean rest edge, the total energy grows by more than
+    // maxEnergyDrift of the kinetic energy or the Newton solve doesn't converge.
+    Scalar minTimeStep = 1e-5;
+    Scalar maxTimeStep = 1.0/60;
+    Scalar maxDisplacement = 0.25;
+    Scalar maxEnergyDrift = 0.05;
+    // Step proposed for the next substep and its limit, 0 until the first advance.
+    Scalar nextTimeStep = 0;
+    TimeStepLimit nextLimit = TimeStepLimit::MaxStep;
+    TimeStepStats timeStepStats;
+    // Mean length of rest edges at every vertex.
+    VectorX vertexEdgeLengths;
+    // Energy of lifting the mesh by a mean rest edge, the energy drift is measured against at least this much.
+    Scalar energyFloor = 0;
+    // State at the start of a substep, restored when it is rejected.
+    VectorX q_saved;
+    VectorX q_dot_saved;
+    
+    // Newton solver stops when the residual drops below newtonTolerance times the initial one.
+    Scalar newtonTolerance = 1e-3;
+    int newtonMaxIterations = 20;
+    SolverStats solverStats;
+    // System matrix M + h^2*K, shares the sparsity pattern of M and K.
+    SparseMatrix A;
+    // Factorization of A, the pattern is analyzed once and only numeric factorization is done per iteration.
+    Eigen::SimplicialLDLT<SparseMatrix> systemSolver;
+    VectorX systemSolveTmp;
+    VectorX systemDiagonalInv;
+    bool systemPatternAnalyzed = false;
+    // M + h^2*K at rest and its factorization, redone only when h changes. Direct solves of constantStiffness
+    // materials use it in place of the current system, the line search makes up for the rotation of the elements.
+    // Held vertices and self-contacts are solved for with conjugate gradients preconditioned by it.
+    SparseMatrix restSystem;
+    Eigen::SimplicialLDLT<SparseMatrix> restSystemSolver;
+    VectorX restSystemDiagonalInv;
+    VectorX restSolveTmp;
+    Scalar restSystemTimeStep = 0;
+    // Rotation of every tetrahedron at its last evaluation, where models built on the rotation start the next one,
+    // and stiffness at rest of every tetrahedron of constantStiffness models, which is rotated by it.
+    AlignedVector<Eigen::Quaternion<ElementScalar>> elementRotations;
+    AlignedVector<Matrix12<ElementScalar>> restStiffnesses;
+    
+    LinearSolver linearSolver = LinearSolver::Direct;
+    Preconditioner preconditionerType = Preconditioner::BlockJacobi;
+    ConjugateGradient<Scalar> cg;
+    // Levels are built on the first multigrid solve, coarse matrices are recomputed for every system.
+    Multigrid<Scalar> multigrid;
+    bool multigridBuilt = false;
+    // Hessians of strain energy of tetrahedra times their volumes at the point the system is linearized at.
+    AlignedVector<Matrix9<ElementScalar>> elementHessians;
+    // Accumulation buffers of matrix-vector products and of 3x3 diagonal blocks of K, one per loop block.
+    std::vector<VectorX> productBuffers;
+    std::vector<VectorX> blockBuffers;
+    // 3x3 diagonal blocks of M, 9 column-major entries per vertex.
+    VectorX massBlocks;
+    // Inverses of 3x3 diagonal blocks of the system, diagonal only for Jacobi preconditioner.
+    VectorX preconditionerBlocks;
+    
+    // Projective Dynamics local/global iterations per step.
+    int projectiveIterations = 10;
+    // Global matrix M/h^2 + sum of weighted B^T*B and its factorization, redone only when h changes.
+    SparseMatrix projectiveMatrix;
+    Eigen::SimplicialLDLT<SparseMatrix> projectiveSolver;
+    VectorX projectiveDiagonalInv;
+    Scalar projectiveTimeStep = 0;
+    
+    // Reduced order simulation, q = modeRestPositions + modes*z with M-orthonormal columns of modes. The first
+    // modeEigenvalues.size() columns are vibration modes, modal derivatives follow and make the step nonlinear.
+    MatrixX modes;
+    VectorX modeEigenvalues;
+    VectorX modeRestPositions;
+    // Reduced forces at the rest positions (gravity), all the linear step needs besides the eigenvalues.
+    VectorX modalForces;
+    bool modalNonlinear = false;
+    // Modal coordinates and velocities of the current state, trial coordinates and buffers of the reduced solve.
+    VectorX modalCoordinates;
+    VectorX modalVelocities;
+    VectorX modalTrial;
+    VectorX modalVelocity;
+    VectorX modalTrialVelocity;
+    VectorX modalGradient;
+    VectorX modalTrialGradient;
+    VectorX modalDirection;
+    // Tetrahedra the reduced forces are summed over with their weights, all of them with weight 1 until
+    // a cubature is computed. Deformation gradients are linear in the modal coordinates, the 9 rows B*U_s of
+    // every tetrahedron are stored contiguously, with its flattened deformation gradient at the rest positions.
+    std::vector<int> modalTets;
+    std::vector<Scalar> modalTetWeights;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> modalTetJacobians;
+    VectorX modalTetRest;
+    // Relative error of the cubature on its training poses.
+    double cubatureError = 0;
+    // Reduced stiffness, lower triangle only, and per block buffers of the sums over tetrahedra.
+    MatrixX modalHessian;
+    std::vector<Scalar> modalEnergyBuffers;
+    std::vector<VectorX> modalGradientBuffers;
+    std::vector<MatrixX> modalHessianBuffers;
+    std::vector<MatrixX> modalGatherBuffers;
+    Eigen::LDLT<MatrixX> modalSolver;
+    
+    // Vertex block descent sweeps over all vertices per step.
+    int blockDescentIterations = 10;
+    // Vertices of the same color share no tetrahedra and are updated in parallel.
+    std::vector<std::vector<int>> vertexColors;
+    // Color of every vertex.
+    std::vector<int> vertexColor;
+    // Tetrahedra around vertex v are vertexTets[vertexTetOffsets[v]..vertexTetOffsets[v + 1]),
+    // stored as 4*tetrahedron + position of v in it.
+    std::vector<int> vertexTetOffsets;
+    std::vector<int> vertexTets;
+    // Row sums of the mass matrix, vertex block descent always uses lumped masses.
+    VectorX vertexMasses;
+    
+    // Preallocated vectors of simulation steps.
+    VectorX f_tmp;
+    VectorX rightHandSide;
+    VectorX new_q_dot;
+    VectorX q_tmp;
+    VectorX v_tmp;
+    VectorX massTmp;
+    VectorX energyGradient;
+    VectorX direction;
+    VectorX trialVelocity;
+    // Static obstacles, vertices stay outside all of them.
+    std::vector<const SignedDistanceField *> obstacles;
+    // Signed distance of every vertex to the closest obstacle and the outward normal there, filled by queryObstacles.
+    VectorX obstacleDistances;
+    VectorX obstacleNormals;
+    // Vertices held at obstacles during a Newton step only move along the surface, contactNormals
+    // holds their normals and is 0 for the rest.
+    std::vector<int> contactVertices;
+    VectorX contactNormals;
+    
+    // Vertex-triangle contacts of the boundary surface with itself, found once per step and resolved with
+    // a penalty energy k/2*min(gap, 0)^2 that is part of V.
+    bool selfCollision = false;
+    SelfCollision<Scalar> surfaceCollision;
+    // Distance kept between surface vertices and triangles.
+    Scalar collisionThickness = 0;
+    // Penalty stiffness in units of mass of the contact vertex over h^2, so a contact is resolved within a step.
+    Scalar collisionStiffness = 1;
+    // Stiffness of every contact active at the point the system was linearized at, 0 for the inactive ones.
+    std::vector<Scalar> contactStiffnesses;
+    // Acceleration at current q, reused by the first half step of velocity Verlet.
+    VectorX acceleration;
+    bool accelerationValid = false;
+    
+    // Number of simulation steps made so far.
+    long steps = 0;
+    // Heap allocations made by the last simulation step (COUNT_ALLOCATIONS builds only).
+    long lastStepAllocations = 0;
+    
+    // Constitutive model and its parameters.
+    Material<ElementScalar> material;
     // Acceleration of gravity.
-    float g = 3;
+    Scalar g = 3;
     
     Mesh skinMesh;
-    // Reletionship between skin mesh vertices and tetraheda. Mesh index - <Tetrahedron index, skin matrix>.
-    std::map<int, std::tuple<int, Eigen::MatrixXf>> skinMeshTetrahedra;
+    // Skin vertices bound to tetrahedra, sorted by tetrahedron. k-th bound vertex skinVertices[k] is
+    // a combination of vertices of tetrahedron skinTets[k] with barycentric weights skinWeights[4*k..4*k + 3].
+    std::vector<int> skinVertices;
+    std::vector<int> skinTets;
+    std::vector<Scalar> skinWeights;
     
     // Coordinates of i-th tetrahedron flattened into 12x1 vector.
-    Eigen::VectorXf getQTet(int i, Eigen::VectorXf &qq) {
-        Eigen::VectorXf q_i = Eigen::VectorXf::Zero(12);
+    Vector12<Scalar> getQTet(int i, const VectorX &qq) {
+        const TetIndices &indices = elements[i].indices;
+        Vector12<Scalar> q_i;
         for (int j = 0; j < 4; j++) {
-            for(int k = 0; k < 3; k++){
-                q_i[3*j + k] = qq[3*tetIndices[i][j] + k];
-            }
+            q_i.template segment<3>(3*j) = qq.template segment<3>(3*indices[j]);
         }
         return q_i;
     }
     
-    Eigen::Matrix3f getFMat(int i, Eigen::VectorXf &qq) {
-        Eigen::MatrixXf pos = Eigen::MatrixXf::Zero(3, 4);
-        Eigen::VectorXf qTet = getQTet(i, qq);
-        for (int j = 0; j < 4; j ++) {
-            pos.col(j) = qTet.segment(j*3, 3).transpose();
-        }
-        Eigen::MatrixXf F = pos*Ds[i];
-        return F;
+    // Energy density of i-th tetrahedron and its derivatives at the flattened deformation gradient f.
+    void evaluateTet(int i, const Vector9<ElementScalar> &f, ElementScalar *psi, Vector9<ElementScalar> *grad, Matrix9<ElementScalar> *hess) {
+        evaluateElement(material, f, elementRotations[i], psi, grad, hess);
     }
     
+    // Stiffness of i-th tetrahedron at the flattened deformation gradient f, from the rest one for constantStiffness models.
+    Matrix12<ElementScalar> tetStiffness(int i, const Vector9<ElementScalar> &f) {
+        if (Material<ElementScalar>::constantStiffness) {
+            return elementStiffness(material, elements[i], f, elementRotations[i], restStiffnesses[i]);
+        }
+        return elementStiffness(material, elements[i], f);
+    }
     
-    Eigen::VectorXf getFFlat(int i, Eigen::VectorXf &qq) {
-        Eigen::VectorXf ff = Eigen::VectorXf::Zero(9);
-        auto fMat = getFMat(i, qq);
-        for(int k = 0; k<3; k++) {
-            for(int j = 0; j<3; j++) {
-                ff[k*3 + j] = fMat(k,j);
-            }
+    // Vertex positions are read straight from qq and accumulated into F = sum of x_j*D_j.
+    // Positions are rounded to ElementScalar here, the rest of the kernel runs in it.
+    ElementMatrix3 getFMat(int i, const VectorX &qq) {
+        const Element &element = elements[i];
+        ElementMatrix3 fMat = qq.template segment<3>(3*element.indices[0]).template cast<ElementScalar>()*element.D.row(0);
+        for (int j = 1; j < 4; j++) {
+            fMat.noalias() += qq.template segment<3>(3*element.indices[j]).template cast<ElementScalar>()*element.D.row(j);
         }
+        return fMat;
+    }
+    
+    // Deformation gradient flattened row by row.
+    Vector9<ElementScalar> getFFlat(int i, const VectorX &qq) {
+        Vector9<ElementScalar> ff;
+        Eigen::Map<Eigen::Matrix<ElementScalar, 3, 3, Eigen::RowMajor>>(ff.data()) = getFMat(i, qq);
         return ff;
     }
-    Eigen::VectorXf forwardEulerStep();
-    Eigen::VectorXf backwardEulerLinearStep();
-    Eigen::VectorXf gradiendDescent(float a, float tol, bool verbose);
-    float V(Eigen::VectorXf &qq);
-    float E(Eigen::VectorXf &v);
-    Eigen::VectorXf dVdQ(Eigen::VectorXf &qq);
-    SparseMatrixf ddVddQ(Eigen::VectorXf &qq);
-    Eigen::VectorXf dEdV(Eigen::VectorXf &v);
+    // Solves M*a = f.
+    void applyInverseMass(const VectorX &f, VectorX &a);
+    void forwardEulerStep(VectorX &new_q_dot);
+    void velocityVerletStep(VectorX &new_q_dot);
+    void velocityVerletFinish();
+    void backwardEulerLinearStep(VectorX &new_q_dot);
+    // Fixed step gradient descent on the incremental potential, starting from the current velocity.
+    void gradiendDescent(Scalar a, Scalar tol, bool verbose, VectorX &new_q_dot);
+    void newtonStep(VectorX &new_q_dot);
+    void projectiveDynamicsStep(VectorX &new_q_dot);
+    void factorizeProjectiveSystem();
+    void vertexBlockDescentStep(VectorX &new_q_dot);
+    void modalStep(VectorX &new_q_dot);
+    // Incremental potential of modal velocities v and its gradient, both leave the positions in q_tmp.
+    Scalar modalEnergy(const VectorX &v, VectorX *grad);
+    void setModalTets(const std::vector<int> &tets, const std::vector<Scalar> &weights);
+    // Weighted sums of elastic energy, its gradient and Hessian with respect to modal coordinates zz over the
+    // tetrahedra of the reduced forces. Pass nullptr for the values that are not needed.
+    void modalElementTerms(const VectorX &zz, Scalar *energy, VectorX *grad, MatrixX *hess);
+    uint64_t cubatureChecksum(int poses, Scalar tolerance, int maxTets);
+    // Fills skinning tables, every skin vertex is bound to the tetrahedron containing it or to the closest one.
+    void bindSkin();
+    // Signed distance from p to the closest obstacle and its outward normal, the largest Scalar without obstacles.
+    Scalar obstacleDistance(const Vector3 &p, Vector3 &normal) const;
+    // Fills obstacleDistances and obstacleNormals for vertex positions qq in parallel.
+    void queryObstacles(const VectorX &qq);
+    // Holds free vertices that velocities v take into obstacles, their normal velocity is removed and stays 0
+    // for the rest of the Newton step. Returns true if any vertex was held.
+    bool holdAtObstacles(VectorX &v);
+    // Removes normal components of held vertices from v.
+    void projectContacts(VectorX &v);
+    // Finds self-collision contacts at the start of a step.
+    void detectSelfCollisions();
+    Scalar contactGap(const SurfaceContact<Scalar> &contact, const VectorX &qq) const;
+    Scalar contactStiffness(const SurfaceContact<Scalar> &contact) const;
+    // Penalty energy of contacts at qq and its gradient added to grad.
+    Scalar contactEnergy(const VectorX &qq);
+    void addContactGradient(const VectorX &qq, VectorX &grad);
+    // Fills contactStiffnesses at qq. Contact Hessians are approximated by their diagonal blocks k*w_j^2*n*n^T,
+    // which stay in the sparsity pattern of K; the line search makes up for the rest.
+    void linearizeContacts(const VectorX &qq);
+    // Kinetic plus potential energy of the current state without the penalty energy of self-contacts, which
+    // depends on h and on the contacts found. The kinetic part is written to kinetic.
+    Scalar totalEnergy(Scalar &kinetic);
+    void computeRestStiffnesses();
+    void factorizeRestSystem();
+    // Solves the system of a constantStiffness model with held vertices or self-contacts with the rest system.
+    bool solveRestSystem(VectorX &qq, const VectorX &b, VectorX &x);
+    // Assembles M + h^2*K(qq) into A, with blocks of held vertices projected as in applySystem.
+    void assembleSystem(VectorX &qq);
+    // Factorizes M + h^2*K(qq), the sparsity pattern is analyzed on the first call only.
+    void factorizeSystem(VectorX &qq);
+    // Evaluates element Hessians at qq and the preconditioner for the matrix-free solver.
+    void linearizeSystem(VectorX &qq);
+    // out = (M + h^2*K)*v using element Hessians. Blocks of held vertices are projected onto their tangent planes,
+    // normal velocities map to themselves.
+    void applySystem(const VectorX &v, VectorX &out);
+    void applyPreconditioner(const VectorX &r, VectorX &z);
+    // Solves (M + h^2*K(qq))*x = b with the selected linear solver, x holds the initial guess.
+    // Returns false if the direct solver failed to factorize the matrix.
+    bool solveSystem(VectorX &qq, const VectorX &b, VectorX &x);
+    // Energy minimized by backward Euler step, its gradient (valid until the next call) with respect to velocities v.
+    Scalar E(VectorX &v);
+    VectorX &dEdV(VectorX &v);
+    
+    // Adds gradient of the potential energy of i-th tetrahedron to grad.
+    void addTetGradient(int i, VectorX &qq, VectorX &grad);
+    // Adds gradient of elastic energy dVdQ_i of i-th tetrahedron and its gravitational potential to grad.
+    void scatterTetGradient(int i, const Vector12<ElementScalar> &dVdQ_i, VectorX &grad);
+    // Calls body(i, block) for every tetrahedron i according to elementLoop.
+    template<typename Body>
+    void forEachTet(Body body);
+    // Number of accumulation buffers forEachTet writes to.
+    int loopBlocks();
 public:
+    // Potential energy, its gradient and Hessian at coordinates qq.
+    Scalar V(VectorX &qq);
+    VectorX &dVdQ(VectorX &qq);
+    SparseMatrix &ddVddQ(VectorX &qq);
+    
     void simulationStep();
-    void moveFixedPoints(Eigen::Vector3f r);
+    // Advances the simulation by frameTime with as many equal substeps as the error criteria allow,
+    // the step is carried over to the next call.
+    void advance(Scalar frameTime);
+    void moveFixedPoints(Vector3 r);
+    // Lowest count vibration modes of the stiffness at the current positions, which become the rest pose of
+    // Integrator::Modal. Pairwise modal derivatives of the lowest derivativeModes elastic modes are added to
+    // the basis for large deformations, the reduced step is then nonlinear.
+    void computeModes(int count, int derivativeModes = 0);
+    // Picks a weighted subset of tetrahedra that reproduces reduced forces of the current basis on random poses
+    // within tolerance, reduced steps then evaluate only those. With a cachePath the result is read from it if it
+    // was trained for the same basis, mesh and material, otherwise it is trained and written there.
+    void computeCubature(const std::string &cachePath = "", int poses = 50, Scalar tolerance = 0.02, int maxTets = 400);
+    
+    void setIntegrator(Integrator method) {
+        integrator = method;
+        accelerationValid = false;
+    }
+    
+    void setTimeStep(Scalar timeStep) {
+        h = timeStep;
+        accelerationValid = false;
+    }
+    
+    Scalar getTimeStep() {
+        return h;
+    }
+    
+    void setTimeStepRange(Scalar minStep, Scalar maxStep) {
+        minTimeStep = minStep;
+        maxTimeStep = maxStep;
+        nextTimeStep = 0;
+    }
+    
+    // Tolerances of advance: vertex displacement per substep relative to the mean rest edge around the vertex
+    // and growth of the total energy per substep relative to the kinetic energy.
+    void setTimeStepTolerances(Scalar displacement, Scalar energyDrift) {
+        maxDisplacement = displacement;
+        maxEnergyDrift = energyDrift;
+    }
+    
+    const TimeStepStats &getTimeStepStats() {
+        return timeStepStats;
+    }
+    
+    void setNewtonTolerance(Scalar tolerance, int maxIterations) {
+        newtonTolerance = tolerance;
+        newtonMaxIterations = maxIterations;
+        solverStats.residuals.reserve(newtonMaxIterations + 1);
+    }
+    
+    long getModeCount() {
+        return modes.cols();
+    }
+    
+    // Tetrahedra reduced forces are evaluated on and the relative error of their cubature.
+    long getModalTetCount() {
+        return modalTets.size();
+    }
     
-    PhysicalMesh(TetrahedralMesh &mesh, Mesh &skinMesh): skinMesh(skinMesh) {
+    double getCubatureError() {
+        return cubatureError;
+    }
+    
+    // Eigenvalues of the vibration modes against M, squared angular frequencies.
+    const VectorX &getModeEigenvalues() {
+        return modeEigenvalues;
+    }
+    
+    const SolverStats &getSolverStats() {
+        return solverStats;
+    }
+    
+    // Levels of the multigrid solvers, empty until their first solve.
+    const Multigrid<Scalar> &getMultigrid() {
+        return multigrid;
+    }
+    
+    void setLinearSolver(LinearSolver solver, Preconditioner preconditioner = Preconditioner::BlockJacobi) {
+        linearSolver = solver;
+        preconditionerType = preconditioner;
+    }
+    
+    // Coarse grids of the multigrid solvers are added until one has at most coarsestSize vertices.
+    void setMultigridCoarsestSize(long coarsestSize) {
+        multigrid.coarsestSize = coarsestSize;
+        multigridBuilt = false;
+    }
+    
+    void setProjectiveIterations(int iterations) {
+        projectiveIterations = iterations;
+    }
+    
+    void setBlockDescentIterations(int iterations) {
+        blockDescentIterations = iterations;
+    }
+
+    // Adds a static collider, the field has to outlive the mesh.
+    void addObstacle(const SignedDistanceField &obstacle) {
+        obstacles.push_back(&obstacle);
+    }
+
+    void clearObstacles() {
+        obstacles.clear();
+    }
+
+    // Conjugate gradient stops at this residual relative to the right hand side.
+    void setLinearTolerance(Scalar tolerance, int maxIterations) {
+        cg.tolerance = tolerance;
+        cg.maxIterations = maxIterations;
+    }
+    
+    void setElementLoop(ElementLoop loop) {
+        elementLoop = loop;
+    }
+    
+    void setThreadCount(int count) {
+        threads = count;
+    }
+    
+    // Replaces parameters of the constitutive model, matrices that depend on them are rebuilt on the next step.
+    void setMaterial(const Material<ElementScalar> &parameters) {
+        material = parameters;
+        computeRestStiffnesses();
+        projectiveTimeStep = 0;
+        restSystemTimeStep = 0;
+        accelerationValid = false;
+    }
+    
+    const Material<ElementScalar> &getMaterial() {
+        return material;
+    }
+    
+    // Switches dVdQ between batched SIMD and per-tetrahedron evaluation of forces.
+    void setBatchedForces(bool enabled) {
+        useBatchedForces = enabled;
+    }
+    
+    void setSimdLevel(SimdLevel level) {
+        batchedForces.setSimdLevel(level);
+    }
+    
+    SimdLevel getSimdLevel() {
+        return batchedForces.getSimdLevel();
+    }
+    
+    long getTetCount() {
+        return n_tet;
+    }
+    
+    // Coordinates of all vertices, vertex i of the mesh file is at getVertexIndex(i).
+    const VectorX &getPositions() {
+        return q;
+    }
+    
+    int getVertexIndex(int meshVertex) {
+        return vertexIndex[meshVertex];
+    }
+    
+    // Enables contacts of the boundary surface with itself.
+    void setSelfCollision(bool enabled) {
+        selfCollision = enabled;
+        if (!enabled) {
+            surfaceCollision.clear();
+        }
+    }
+    
+    // Distance kept between surface vertices and triangles, 1/10 of the mean boundary edge by default.
+    void setCollisionThickness(Scalar thickness) {
+        collisionThickness = thickness;
+    }
+    
+    // Self-collision contacts found in the last step.
+    int getSelfContactCount() {
+        return surfaceCollision.contacts.size();
+    }
+    
+    long getLastStepAllocations() {
+        return lastStepAllocations;
+    }
+    
+    // Prints bytes of topology and rest state per tetrahedron. The previous layout, a heap allocated index list
+    // and separate T, B, D and volume arrays, is printed for comparison, allocator overhead is not counted.
+    void printMemoryReport() {
+        size_t previous = sizeof(std::vector<int>) + 4*sizeof(int) + sizeof(Eigen::Matrix3f) + sizeof(Matrix9x12f)
+            + sizeof(Matrix4x3f) + sizeof(float);
+        std::cout << "Element storage: " << sizeof(Element) << " bytes per tet, "
+                  << previous << " bytes per tet before packing, "
+                  << sizeof(Element)*n_tet/1024 << " KiB for " << n_tet << " tets" << std::endl;
+    }
+    
+    PhysicalMesh(TetrahedralMesh &mesh, Mesh &skinMesh, MassMatrix massMatrix = MassMatrix::Consistent,
+                 VertexOrdering ordering = VertexOrdering::ReverseCuthillMcKee):
+        massMatrix(massMatrix), skinMesh(skinMesh) {
         n = mesh.positions.size();
-        q = Eigen::VectorXf::Zero(n*3);
-        q_dot = Eigen::VectorXf::Zero(n*3);
+        q = VectorX::Zero(n*3);
+        q_dot = VectorX::Zero(n*3);
         n_tet = mesh.indices.size()/4;
         
-        // Filling up positions vector from original mesh.
+        // Filling up positions vector from original mesh in the new vertex order.
+        std::vector<int> vertexOrder = orderVertices(ordering, mesh.positions, mesh.indices);
+        vertexIndex.resize(n);
         for(int i = 0; i<n; i++) {
-            q.segment(i*3, 3) = mesh.positions[i];
+            q.segment(i*3, 3) = mesh.positions[vertexOrder[i]].cast<Scalar>();
+            vertexIndex[vertexOrder[i]] = i;
+        }
+        
+        // Tetrahedra sorted by their lowest vertex in the new order, so element loops walk q forward.
+        // Rest state and skin bindings below are computed for the sorted tetrahedra.
+        std::vector<int> tetOrder(n_tet);
+        std::vector<int> lowestVertex(n_tet);
+        for (int i = 0; i<n_tet; i++) {
+            tetOrder[i] = i;
+            lowestVertex[i] = n;
+            for (int j = 0; j<4; j++) {
+                lowestVertex[i] = std::min(lowestVertex[i], vertexIndex[mesh.indices[i*4 + j]]);
+            }
+        }
+        if (ordering != VertexOrdering::None) {
+            std::stable_sort(tetOrder.begin(), tetOrder.end(), [&](int a, int b) { return lowestVertex[a] < lowestVertex[b]; });
+        }
+        elements.resize(n_tet);
+        for (int i = 0; i<n_tet; i++) {
+            for (int j = 0; j<4; j++) {
+                elements[i].indices[j] = vertexIndex[mesh.indices[tetOrder[i]*4 + j]];
+            }
         }
         
-        M = SparseMatrixf(3*n,3*n);
+        // Mass and stiffness matrices share the sparsity pattern of the mesh.
+        // The stiffness one is only built on the first assembly, matrix-free solves don't need it.
+        SparseAssembler<Scalar> massAssembler(n, elements);
         
         // Matrix multiplier individual tetrahedron mass matrix.
-        Eigen::MatrixXf M_i = Eigen::MatrixXf::Identity(12,12);
-        Eigen:: VectorXf v = Eigen::VectorXf::Zero(12);
+        MatrixX M_i = MatrixX::Identity(12,12);
+        VectorX v = VectorX::Zero(12);
         v[2] = 1; v[5] = 1; v[8] = 1; v[11] = 1;
         for (int j = 0; j<12; j++) {
-            Eigen:: VectorXf v_temp = Eigen::VectorXf::Zero(12);
+            VectorX v_temp = VectorX::Zero(12);
             int last = v[11];
             v_temp[0] = last;
             for (int k = 0; k<11; k++) {
@@ -120,87 +735,172 @@ public:
         }
         
         for (int i = 0; i<n_tet; i++) {
-            std::vector<int> tetIndex;
-            tetIndex.push_back(mesh.indices[i*4]);
-            tetIndex.push_back(mesh.indices[i*4 + 1]);
-            tetIndex.push_back(mesh.indices[i*4 + 2]);
-            tetIndex.push_back(mesh.indices[i*4 + 3]);
-            tetIndices.push_back(tetIndex);
-            
-            Eigen::VectorXf qTet = getQTet(i, q);
+            Vector12<Scalar> qTet = getQTet(i, q);
             
-            Eigen::Vector3f q0 = qTet.segment(0,3);
-            Eigen::Vector3f q1 = qTet.segment(3,3);
-            Eigen::Vector3f q2 = qTet.segment(6,3);
-            Eigen::Vector3f q3 = qTet.segment(9,3);
+            Vector3 q0 = qTet.segment(0,3);
+            Vector3 q1 = qTet.segment(3,3);
+            Vector3 q2 = qTet.segment(6,3);
+            Vector3 q3 = qTet.segment(9,3);
              
             // Calculating volumes.
-            float vol = abs(((q1 - q0).cross(q2-q0)).dot(q3-q0)/6);
+            Scalar vol = std::abs(((q1 - q0).cross(q2-q0)).dot(q3-q0)/6);
             //std::cout << vol << std::endl;
-            volumes.push_back(vol);
+            elements[i].volume = vol;
             
             // Calculating utility matrices.
-            Eigen::Matrix3f T_i = Eigen::MatrixXf::Zero(3,3);
+            Matrix3 T_i = Matrix3::Zero();
             
             T_i.col(0) = q1 - q0;
             T_i.col(1) = q2 - q0;
             T_i.col(2) = q3 - q0;
-        
-            Ts.push_back(T_i);
             
-            Eigen::Matrix3f T_i_inv = T_i.inverse();
+            Matrix3 T_i_inv = T_i.inverse();
     
-            Eigen::MatrixXf hm = - Eigen::Vector3f::Ones(3).transpose() * T_i_inv;
-            Eigen::MatrixXf D_i = Eigen::MatrixXf::Zero(4,3);
-            D_i.block(0, 0, 1, 3) = hm;
-            D_i.block(1, 0, 3, 3) = T_i_inv;
+            Matrix4x3<Scalar> D_i;
+            D_i.row(0) = - Vector3::Ones().transpose() * T_i_inv;
+            D_i.template block<3,3>(1, 0) = T_i_inv;
 
-            Ds.push_back(D_i);
-            
-            Eigen::MatrixXf B_i = Eigen::MatrixXf::Zero(9,12);
-            for (int j = 0; j<4; j++) {
-                auto v = D_i.row(j);
-                for (int k= 0; k<3;k++) {
-                B_i.block(k*3, j*3 + k, 3, 1) = v.transpose();
-                }
-            }
-            Bs.push_back(B_i);
+            elements[i].D = D_i.template cast<ElementScalar>();
             
             // Assembling mass matrix.
-            for (int j = 0; j<12; j++) {
-                for (int k = 0; k<12; k++) {
-                    M.coeffRef(3*tetIndex[(int)(j/3)] +  j%3, 3*tetIndex[(int)(k/3)] + k%3) += vol*M_i(j,k)/20;
+            if (massMatrix == MassMatrix::Lumped) {
+                massAssembler.addElement(i, MatrixX(vol*(M_i/20).rowwise().sum().asDiagonal()));
+            } else {
+                massAssembler.addElement(i, vol*M_i/20);
+            }
+        }
+        bindSkin();
+        M = massAssembler.getMatrix();
+        if (massMatrix == MassMatrix::Lumped) {
+            M_lumped_inv = VectorX(M.diagonal()).cwiseInverse();
+        } else {
+            massSolver.compute(M);
+            massSolveTmp = VectorX::Zero(3*n);
+            massDiagonalInv = massSolver.vectorD().cwiseInverse();
+        }
+        massBlocks = VectorX::Zero(9*n);
+        for (int col = 0; col<M.outerSize(); col++) {
+            for (typename SparseMatrix::InnerIterator it(M, col); it; ++it) {
+                if (it.row()/3 == col/3) {
+                    massBlocks[9*(col/3) + 3*(col%3) + it.row()%3] = it.value();
                 }
             }
-            
-        // Calculating skinning matrices.
-        for(int j = 0; j< skinMesh.positions.size(); j++){
-                Eigen::Vector3f v = skinMesh.positions[j];
-                Eigen::Vector3f phi = T_i_inv*(v - q0);
-                if(phi[0] < 1 && phi[0] > 0 && phi[1] < 1 && phi[1] > 0 && phi[2] < 1 && phi[2] > 0) {
-                    Eigen::MatrixXf w = Eigen::MatrixXf::Zero(3,12);
-                    w.block(0,0,3,3) = (1 - phi[0] - phi[1] - phi[2]) * Eigen::MatrixXf::Identity(3,3);
-                    w.block(0,3,3,3) = phi[0] * Eigen::MatrixXf::Identity(3,3);
-                    w.block(0,6,3,3) = phi[1] * Eigen::MatrixXf::Identity(3,3);
-                    w.block(0,9,3,3) = phi[2] * Eigen::MatrixXf::Identity(3,3);
-                    skinMeshTetrahedra[j] = std::make_tuple(i, w);
+        }
+        tetColors = colorTetrahedra(n, elements);
+        vertexColors = colorVertices(n, elements);
+        vertexColor.resize(n);
+        for (int c = 0; c<vertexColors.size(); c++) {
+            for (int v : vertexColors[c]) {
+                vertexColor[v] = c;
+            }
+        }
+        vertexTetOffsets.assign(n + 1, 0);
+        for (int i = 0; i<n_tet; i++) {
+            for (int v : elements[i].indices) {
+                vertexTetOffsets[v + 1]++;
+            }
+        }
+        for (int v = 0; v<n; v++) {
+            vertexTetOffsets[v + 1] += vertexTetOffsets[v];
+        }
+        vertexTets.resize(4*n_tet);
+        std::vector<int> fill(vertexTetOffsets.begin(), vertexTetOffsets.end() - 1);
+        for (int i = 0; i<n_tet; i++) {
+            for (int k = 0; k<4; k++) {
+                vertexTets[fill[elements[i].indices[k]]++] = 4*i + k;
+            }
+        }
+        VectorX rowSums = M*VectorX::Ones(3*n);
+        vertexMasses.resize(n);
+        for (int v = 0; v<n; v++) {
+            vertexMasses[v] = rowSums[3*v];
+        }
+        // Mean rest edge at every vertex and of the whole mesh, length scales of the error criteria of advance.
+        // Edges shared by several tetrahedra are counted once per tetrahedron.
+        vertexEdgeLengths = VectorX::Zero(n);
+        VectorX vertexEdgeCounts = VectorX::Zero(n);
+        Scalar edgeSum = 0;
+        Scalar totalVolume = 0;
+        for (int i = 0; i<n_tet; i++) {
+            const TetIndices &indices = elements[i].indices;
+            for (int a = 0; a<4; a++) {
+                for (int b = a + 1; b<4; b++) {
+                    Scalar length = (q.template segment<3>(3*indices[a]) - q.template segment<3>(3*indices[b])).norm();
+                    vertexEdgeLengths[indices[a]] += length;
+                    vertexEdgeLengths[indices[b]] += length;
+                    vertexEdgeCounts[indices[a]]++;
+                    vertexEdgeCounts[indices[b]]++;
+                    edgeSum += length;
                 }
             }
+            totalVolume += elements[i].volume;
+        }
+        // Vertices outside tetrahedra never limit the step.
+        for (int v = 0; v<n; v++) {
+            vertexEdgeLengths[v] = vertexEdgeCounts[v] > 0 ? vertexEdgeLengths[v]/vertexEdgeCounts[v] : std::numeric_limits<Scalar>::max();
         }
+        // Gravity acts on every vertex of a tetrahedron with volume*g, see V.
+        energyFloor = n_tet > 0 ? 4*totalVolume*g*edgeSum/(6*n_tet) : 0;
+        if (Material<ElementScalar>::batched) {
+            batchedForces = BatchedElementForces<ElementScalar>(elements);
+        }
+        elementRotations.assign(n_tet, Eigen::Quaternion<ElementScalar>::Identity());
+        computeRestStiffnesses();
+        surfaceCollision = SelfCollision<Scalar>(elements, n, q);
+        collisionThickness = Scalar(0.1)*surfaceCollision.getMeanEdge();
+        contactStiffnesses.reserve(n);
+        
+        f_tmp = VectorX::Zero(3*n);
+        rightHandSide = VectorX::Zero(3*n);
+        new_q_dot = VectorX::Zero(3*n);
+        acceleration = VectorX::Zero(3*n);
+        q_tmp = VectorX::Zero(3*n);
+        v_tmp = VectorX::Zero(3*n);
+        massTmp = VectorX::Zero(3*n);
+        energyGradient = VectorX::Zero(3*n);
+        direction = VectorX::Zero(3*n);
+        trialVelocity = VectorX::Zero(3*n);
+        q_saved = VectorX::Zero(3*n);
+        q_dot_saved = VectorX::Zero(3*n);
+        obstacleDistances = VectorX::Constant(n, std::numeric_limits<Scalar>::max());
+        obstacleNormals = VectorX::Zero(3*n);
+        contactVertices.reserve(n);
+        contactNormals = VectorX::Zero(3*n);
+        systemSolveTmp = VectorX::Zero(3*n);
+        restSolveTmp = VectorX::Zero(3*n);
+        cg.resize(3*n);
+        solverStats.residuals.reserve(newtonMaxIterations + 1);
     };
     
+    // Writes deformed positions of skin vertices into positions. The buffer is set to the rest pose when its size
+    // doesn't match the skin mesh.
+    void updateSkinPositions(std::vector<Eigen::Vector3f> &positions) {
+        if (positions.size() != skinMesh.positions.size()) {
+            positions = skinMesh.positions;
+        }
+        int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+        int n_bound = skinVertices.size();
+        #pragma omp parallel for num_threads(n_threads) schedule(static)
+        for (int k = 0; k<n_bound; k++) {
+            const TetIndices &indices = elements[skinTets[k]].indices;
+            const Scalar *w = &skinWeights[4*k];
+            positions[skinVertices[k]] = (w[0]*q.template segment<3>(3*indices[0]) + w[1]*q.template segment<3>(3*indices[1])
+                + w[2]*q.template segment<3>(3*indices[2]) + w[3]*q.template segment<3>(3*indices[3])).template cast<float>();
+        }
+    }
+    
+    // Copy of the skin mesh in the current pose, updateSkinPositions avoids copying it every frame.
     Mesh getSkinMesh() {
         Mesh skinnedMesh = skinMesh;
-        for ( const auto &skinMeshPair : skinMeshTetrahedra ) {
-            int i_vert = skinMeshPair.first;
-            int i_tet = std::get<0>(skinMeshPair.second);
-            Eigen::MatrixXf w = std::get<1>(skinMeshPair.second);
-            skinnedMesh.positions[i_vert] = w * getQTet(i_tet, q);
-        }
-        
+        updateSkinPositions(skinnedMesh.positions);
         return skinnedMesh;
     }
 
 };
 
+typedef PhysicalMesh<float> PhysicalMeshf;
+typedef PhysicalMesh<double> PhysicalMeshd;
+// Double precision state and solves with single precision element kernels.
+typedef PhysicalMesh<double, float> PhysicalMeshMixed;
+
 #endif /* physical_mesh_h */
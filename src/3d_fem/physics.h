@@ -6,100 +6,1393 @@
 #include <Eigen/Sparse>
 #include <tuple>
 #include <algorithm>
+#include <cstring>
 #include "physical_mesh.h"
 #include "gradient.h"
 #include "hessian.h"
+#include "neo_hookean.h"
+#include "conjugate_gradient.h"
 
 typedef Eigen::SparseMatrix<float> SparseMatrixf;
 typedef Eigen::Triplet<double> T;
 
-const float h = 0.001f;
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+int PhysicalMesh<Scalar, ElementScalar, Material>::loopBlocks() {
+    if (elementLoop == ElementLoop::Reduction) {
+        return std::max(1, (int)std::min((long)reductionBlocks, n_tet));
+    }
+    return 1;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+template<typename Body>
+void PhysicalMesh<Scalar, ElementScalar, Material>::forEachTet(Body body) {
+    int n_threads = resolveThreadCount(threads);
+    switch (elementLoop) {
+        case ElementLoop::Serial:
+            for (int i = 0; i<n_tet; i++) {
+                body(i, 0);
+            }
+            break;
+        case ElementLoop::Colored:
+            for (const auto &color : tetColors) {
+                int n_color = color.size();
+                #pragma omp parallel for num_threads(n_threads) schedule(static)
+                for (int k = 0; k<n_color; k++) {
+                    body(color[k], 0);
+                }
+            }
+            break;
+        case ElementLoop::Reduction: {
+            int blocks = loopBlocks();
+            #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+            for (int b = 0; b<blocks; b++) {
+                long begin = n_tet*b/blocks;
+                long end = n_tet*(b + 1)/blocks;
+                for (long i = begin; i<end; i++) {
+                    body(i, b);
+                }
+            }
+            break;
+        }
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::scatterTetGradient(int i, const Vector12<ElementScalar> &dVdQ_i, VectorX &grad) {
+    for(int k = 0; k< 4; k++) {
+        int index = elements[i].indices[k];
+        grad.template segment<3>(index*3) += dVdQ_i.template segment<3>(k*3).template cast<Scalar>();
+        grad[index*3+1] += elements[i].volume*g;
+    }
+}
 
-Eigen::VectorXf PhysicalMesh::dVdQ(Eigen::VectorXf &qq) {
-    Eigen::VectorXf dVdQ = Eigen::VectorXf::Zero(3*n);
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::addTetGradient(int i, VectorX &qq, VectorX &grad) {
+    Vector9<ElementScalar> ff_i = getFFlat(i, qq);
+    Vector9<ElementScalar> gradPsi_i;
+    evaluateTet(i, ff_i, nullptr, &gradPsi_i, nullptr);
+    // B^T*gradPsi without forming B, the gradient with respect to j-th vertex is dPsi/dF*D_j.
+    Eigen::Map<const Eigen::Matrix<ElementScalar, 3, 3, Eigen::RowMajor>> P_i(gradPsi_i.data());
+    Matrix3x4<ElementScalar> dVdQ_i = elements[i].volume * P_i * elements[i].D.transpose();
+    scatterTetGradient(i, Eigen::Map<Vector12<ElementScalar>>(dVdQ_i.data()), grad);
+}
+
+// Returns a reference to an internal buffer, valid until the next call.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &PhysicalMesh<Scalar, ElementScalar, Material>::dVdQ(VectorX &qq) {
+    int blocks = loopBlocks();
+    gradientBuffers.resize(blocks);
+    for (auto &buffer : gradientBuffers) {
+        buffer.setZero(3*n);
+    }
     
-    for(int i = 0; i< n_tet; i++){
-        auto ff_i = getFFlat(i, qq);
-        auto grad = gradPsi(C, D, ff_i);
-        Eigen::VectorXf dVdQ_i = volumes[i] * Bs[i].transpose() * grad;
-            
-        for(int k = 0; k< 4; k++) {
-            int index = tetIndices[i][k];
-            dVdQ.segment(index*3, 3) += dVdQ_i.segment(k*3, 3);
-            dVdQ[index*3+1] += volumes[i]*g;
+    if (useBatchedForces && Material<ElementScalar>::batched) {
+        // Element forces are evaluated by SIMD batches first and scattered to vertices afterwards.
+        int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+        long chunks = batchedForces.chunks();
+        #pragma omp parallel for num_threads(n_threads) schedule(static)
+        for (long c = 0; c<chunks; c++) {
+            long begin = c*BatchedElementForces<ElementScalar>::chunkSize;
+            long end = std::min(begin + BatchedElementForces<ElementScalar>::chunkSize, n_tet);
+            for (long i = begin; i<end; i++) {
+                batchedForces.gather(i, elements[i].indices, qq);
+                if (Material<ElementScalar>::constantStiffness) {
+                    batchedForces.setRotation(i, elementRotations[i]);
+                }
+            }
+            evaluateBatch(material, batchedForces, c);
+            if (Material<ElementScalar>::constantStiffness) {
+                for (long i = begin; i<end; i++) {
+                    elementRotations[i] = batchedForces.rotation(i);
+                }
+            }
         }
+        
+        forEachTet([&](int i, int b) {
+            Vector12<ElementScalar> dVdQ_i;
+            for (int k = 0; k<12; k++) {
+                dVdQ_i[k] = batchedForces.force(i, k);
+            }
+            scatterTetGradient(i, dVdQ_i, gradientBuffers[b]);
+        });
+    } else {
+        forEachTet([&](int i, int b) {
+            addTetGradient(i, qq, gradientBuffers[b]);
+        });
     }
     
+    // Summing block buffers in a fixed order.
+    VectorX &dVdQ = gradientBuffers[0];
+    for (int b = 1; b<blocks; b++) {
+        dVdQ += gradientBuffers[b];
+    }
+    addContactGradient(qq, dVdQ);
     return dVdQ;
 }
 
-SparseMatrixf PhysicalMesh::ddVddQ(Eigen::VectorXf &qq) {
-    SparseMatrixf ddVddQ = SparseMatrixf(3*n,3*n);
-    for(int i = 0; i< n_tet; i++){
-        auto ff_i = getFFlat(i, qq);
-        auto hessian = psi_hessian(C, D, ff_i);
-        Eigen::MatrixXf ddVddQ_i = volumes[i] * Bs[i].transpose() * hessian * Bs[i];
-        std::vector<T> tripletList;
-        for (int j = 0; j<12; j++) {
-            for (int k = 0; k<12; k++) {
-                tripletList.push_back(T(3*tetIndices[i][(int)(j/3)] + j%3,
-                                        3*tetIndices[i][(int)(k/3)] + k%3,
-                                        ddVddQ_i(j,k)));
+// Assembles the stiffness matrix in place, the sparsity pattern is computed once in the constructor.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Eigen::SparseMatrix<Scalar> &PhysicalMesh<Scalar, ElementScalar, Material>::ddVddQ(VectorX &qq) {
+    if (stiffnessAssembler.nonZeros() == 0) {
+        stiffnessAssembler = SparseAssembler<Scalar>(n, elements);
+    }
+    int blocks = loopBlocks();
+    stiffnessAssembler.setZero();
+    if (blocks > 1) {
+        hessianBuffers.resize(blocks);
+        for (auto &buffer : hessianBuffers) {
+            buffer.setZero(stiffnessAssembler.nonZeros());
+        }
+    }
+    
+    forEachTet([&](int i, int b) {
+        Vector9<ElementScalar> ff_i = getFFlat(i, qq);
+        Matrix12<ElementScalar> ddVddQ_i = tetStiffness(i, ff_i);
+        if (blocks > 1) {
+            stiffnessAssembler.addElement(i, ddVddQ_i, hessianBuffers[b].data());
+        } else {
+            stiffnessAssembler.addElement(i, ddVddQ_i);
+        }
+    });
+    
+    // Summing block buffers in a fixed order.
+    SparseMatrix &K = stiffnessAssembler.getMatrix();
+    if (blocks > 1) {
+        auto values = K.coeffs();
+        for (int b = 0; b<blocks; b++) {
+            values += hessianBuffers[b].array();
+        }
+    }
+    linearizeContacts(qq);
+    for (int c = 0; c<contactStiffnesses.size(); c++) {
+        const SurfaceContact<Scalar> &contact = surfaceCollision.contacts[c];
+        for (int j = 0; j<4 && contactStiffnesses[c] > 0; j++) {
+            int v = contact.vertices[j];
+            Matrix3 block = contactStiffnesses[c]*contact.weights[j]*contact.weights[j]*contact.normal*contact.normal.transpose();
+            for (int col = 0; col<3; col++) {
+                for (int row = 0; row<3; row++) {
+                    K.coeffRef(3*v + row, 3*v + col) += block(row, col);
+                }
             }
         }
-        ddVddQ.setFromTriplets(tripletList.begin(), tripletList.end());
     }
-    return ddVddQ;
+    return K;
 }
 
-float PhysicalMesh::V(Eigen::VectorXf &qq) {
-    float V = 0;
+// Elastic and gravitational energies of tetrahedra are evaluated independently and summed in mesh order,
+// so the result doesn't depend on the element loop or the number of threads.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::V(VectorX &qq) {
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    tetEnergies.resize(n_tet);
+    #pragma omp parallel for num_threads(n_threads) schedule(static)
     for(int i = 0; i< n_tet; i++){
-        auto ff_i = getFFlat(i, qq);
-        V += volumes[i]*psi(C, D, ff_i);
+        Vector9<ElementScalar> ff_i = getFFlat(i, qq);
+        ElementScalar psi_i;
+        evaluateTet(i, ff_i, &psi_i, nullptr, nullptr);
+        // Gravity acts on every vertex with volume*g, same as in dVdQ.
+        Scalar height = 0;
+        for (int k = 0; k<4; k++) {
+            height += qq[3*elements[i].indices[k] + 1];
+        }
+        tetEnergies[i] = elements[i].volume*psi_i + elements[i].volume*g*height;
     }
-    return V;
+    
+    Scalar V = 0;
+    for(int i = 0; i< n_tet; i++){
+        V += tetEnergies[i];
+    }
+    return V + contactEnergy(qq);
 }
 
-Eigen::VectorXf PhysicalMesh::dEdV(Eigen::VectorXf &v) {
-    Eigen::VectorXf q_i = q + h*v;
-    return M*(v - q_dot) + h * dVdQ(q_i);
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::totalEnergy(Scalar &kinetic) {
+    massTmp.noalias() = M*q_dot;
+    kinetic = Scalar(0.5)*q_dot.dot(massTmp);
+    return kinetic + V(q) - contactEnergy(q);
 }
 
-// Updating q and q dot using backward Euler method.
-bool inverseCalculated = false;
-Eigen::MatrixXf M_inv;
-Eigen::VectorXf PhysicalMesh::forwardEulerStep() {
-    if (!inverseCalculated) {
-        M_inv = Eigen::MatrixXf::Identity(3*n, 3*n);
-        Eigen::MatrixXf I = Eigen::MatrixXf::Identity(3*n, 3*n);
-        Eigen::SimplicialLDLT<SparseMatrixf> solverLDLT;
-        solverLDLT.compute(M);
-        M_inv = solverLDLT.solve(I);
-        inverseCalculated = true;
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::E(VectorX &v) {
+    q_tmp = q + h*v;
+    v_tmp = v - q_dot;
+    massTmp.noalias() = M*v_tmp;
+    return Scalar(0.5)*v_tmp.dot(massTmp) + V(q_tmp);
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &PhysicalMesh<Scalar, ElementScalar, Material>::dEdV(VectorX &v) {
+    q_tmp = q + h*v;
+    v_tmp = v - q_dot;
+    energyGradient.noalias() = M*v_tmp;
+    energyGradient += h * dVdQ(q_tmp);
+    return energyGradient;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::assembleSystem(VectorX &qq) {
+    SparseMatrix &K = ddVddQ(qq);
+    if (A.nonZeros() != M.nonZeros()) {
+        A = M;
+    }
+    // M and K share the sparsity pattern, so only values are added.
+    A.coeffs() = M.coeffs() + h*h*K.coeffs();
+    // Blocks of held vertices become P_i*A_ij*P_j with P = I - n*n^T, and n*n^T is added on the diagonal,
+    // so normal velocities solve to 0. Every tetrahedron couples all coordinates of its vertices, vertex blocks
+    // of the pattern are full and stored as 3 consecutive rows of 3 consecutive columns.
+    if (!contactVertices.empty()) {
+        Scalar *values = A.valuePtr();
+        const int *rows = A.innerIndexPtr();
+        const int *outer = A.outerIndexPtr();
+        for (int j = 0; j<n; j++) {
+            Matrix3 P_j = Matrix3::Identity() - contactNormals.template segment<3>(3*j)*contactNormals.template segment<3>(3*j).transpose();
+            int length = outer[3*j + 1] - outer[3*j];
+            for (int k = 0; k<length; k += 3) {
+                int i = rows[outer[3*j] + k]/3;
+                if (contactNormals.template segment<3>(3*i).isZero() && contactNormals.template segment<3>(3*j).isZero()) {
+                    continue;
+                }
+                Matrix3 block;
+                for (int c = 0; c<3; c++) {
+                    block.col(c) = Eigen::Map<Vector3>(&values[outer[3*j + c] + k]);
+                }
+                Matrix3 P_i = Matrix3::Identity() - contactNormals.template segment<3>(3*i)*contactNormals.template segment<3>(3*i).transpose();
+                block = P_i*block*P_j;
+                if (i == j) {
+                    block += contactNormals.template segment<3>(3*i)*contactNormals.template segment<3>(3*i).transpose();
+                }
+                for (int c = 0; c<3; c++) {
+                    Eigen::Map<Vector3> column(&values[outer[3*j + c] + k]);
+                    column = block.col(c);
+                }
+            }
+        }
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::factorizeSystem(VectorX &qq) {
+    assembleSystem(qq);
+    if (!systemPatternAnalyzed) {
+        systemSolver.analyzePattern(A);
+        systemPatternAnalyzed = true;
+    }
+#ifdef COUNT_ALLOCATIONS
+    // Factorization permutes the matrix into a temporary, these allocations are expected and still counted.
+    bool mallocAllowed = Eigen::internal::is_malloc_allowed();
+    Eigen::internal::set_is_malloc_allowed(true);
+#endif
+    systemSolver.factorize(A);
+    systemDiagonalInv = systemSolver.vectorD().cwiseInverse();
+    solverStats.factorNonZeros = systemSolver.matrixL().nestedExpression().nonZeros();
+#ifdef COUNT_ALLOCATIONS
+    Eigen::internal::set_is_malloc_allowed(mallocAllowed);
+#endif
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::computeRestStiffnesses() {
+    if (!Material<ElementScalar>::constantStiffness) {
+        return;
+    }
+    Vector9<ElementScalar> identity;
+    Eigen::Map<Eigen::Matrix<ElementScalar, 3, 3, Eigen::RowMajor>>(identity.data()).setIdentity();
+    restStiffnesses.resize(n_tet);
+    for (int i = 0; i<n_tet; i++) {
+        restStiffnesses[i] = elementStiffness(material, elements[i], identity);
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::factorizeRestSystem() {
+    SparseAssembler<Scalar> assembler(n, elements);
+    for (int i = 0; i<n_tet; i++) {
+        assembler.addElement(i, restStiffnesses[i]);
     }
-    Eigen::VectorXf f = -dVdQ(q);
+    // M and the assembled matrix share the sparsity pattern.
+    restSystem = assembler.getMatrix();
+    restSystem.coeffs() = M.coeffs() + h*h*restSystem.coeffs();
+#ifdef COUNT_ALLOCATIONS
+    // Refactorized only when h changes, these allocations are expected and still counted.
+    bool mallocAllowed = Eigen::internal::is_malloc_allowed();
+    Eigen::internal::set_is_malloc_allowed(true);
+#endif
+    restSystemSolver.compute(restSystem);
+    restSystemDiagonalInv = restSystemSolver.vectorD().cwiseInverse();
+    solverStats.factorNonZeros = restSystemSolver.matrixL().nestedExpression().nonZeros();
+#ifdef COUNT_ALLOCATIONS
+    Eigen::internal::set_is_malloc_allowed(mallocAllowed);
+#endif
+    restSystemTimeStep = h;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::linearizeSystem(VectorX &qq) {
+    int blocks = loopBlocks();
+    elementHessians.resize(n_tet);
+    blockBuffers.resize(blocks);
+    for (auto &buffer : blockBuffers) {
+        buffer.setZero(9*n);
+    }
+    
+    forEachTet([&](int i, int b) {
+        Vector9<ElementScalar> ff_i = getFFlat(i, qq);
+        Matrix9<ElementScalar> hessian;
+        evaluateTet(i, ff_i, nullptr, nullptr, &hessian);
+        elementHessians[i] = elements[i].volume*hessian;
+        // Diagonal block of k-th vertex is B_k^T*H*B_k, B_k are the 3 columns of B acting on its coordinates.
+        for (int k = 0; k<4; k++) {
+            Eigen::Matrix<ElementScalar, 9, 3> B_k = elements[i].B(k);
+            ElementMatrix3 block = B_k.transpose()*elementHessians[i]*B_k;
+            Eigen::Map<Matrix3>(&blockBuffers[b][9*elements[i].indices[k]]) += block.template cast<Scalar>();
+        }
+    });
     
-    auto rightHandSide = (M * q_dot + h*f);
+    for (int b = 1; b<blocks; b++) {
+        blockBuffers[0] += blockBuffers[b];
+    }
+    linearizeContacts(qq);
+    for (int c = 0; c<contactStiffnesses.size(); c++) {
+        const SurfaceContact<Scalar> &contact = surfaceCollision.contacts[c];
+        for (int j = 0; j<4 && contactStiffnesses[c] > 0; j++) {
+            Eigen::Map<Matrix3> block(&blockBuffers[0][9*contact.vertices[j]]);
+            block += contactStiffnesses[c]*contact.weights[j]*contact.weights[j]*contact.normal*contact.normal.transpose();
+        }
+    }
+    preconditionerBlocks.resize(9*n);
+    for (int i = 0; i<n; i++) {
+        Matrix3 block = Eigen::Map<Matrix3>(&massBlocks[9*i]) + h*h*Eigen::Map<Matrix3>(&blockBuffers[0][9*i]);
+        Vector3 normal = contactNormals.template segment<3>(3*i);
+        if (!normal.isZero()) {
+            Matrix3 P = Matrix3::Identity() - normal*normal.transpose();
+            block = P*block*P + normal*normal.transpose();
+        }
+        Matrix3 inverse;
+        bool invertible = false;
+        if (preconditionerType == Preconditioner::BlockJacobi) {
+            Scalar determinant;
+            block.computeInverseWithCheck(inverse, invertible, determinant);
+        }
+        // Indefinite or singular blocks fall back to the diagonal.
+        if (!invertible || inverse.diagonal().minCoeff() <= 0) {
+            inverse = block.diagonal().cwiseAbs().cwiseMax(Scalar(1e-12)).cwiseInverse().asDiagonal();
+        }
+        Eigen::Map<Matrix3> preconditionerBlock(&preconditionerBlocks[9*i]);
+        preconditionerBlock = inverse;
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::applySystem(const VectorX &v, VectorX &out) {
+    int blocks = loopBlocks();
+    productBuffers.resize(blocks);
+    for (auto &buffer : productBuffers) {
+        buffer.setZero(3*n);
+    }
+    
+    systemSolveTmp = v;
+    projectContacts(systemSolveTmp);
+    // K*v is the sum of B^T*H*B*v over tetrahedra, B*v is the change of F for vertex velocities v.
+    forEachTet([&](int i, int b) {
+        Matrix3x4<ElementScalar> v_i;
+        for (int j = 0; j<4; j++) {
+            v_i.col(j) = systemSolveTmp.template segment<3>(3*elements[i].indices[j]).template cast<ElementScalar>();
+        }
+        ElementMatrix3 dF = v_i*elements[i].D;
+        Vector9<ElementScalar> dF_flat;
+        for (int k = 0; k<3; k++) {
+            for (int j = 0; j<3; j++) {
+                dF_flat[3*k + j] = dF(k,j);
+            }
+        }
+        Vector9<ElementScalar> dP_flat = elementHessians[i]*dF_flat;
+        ElementMatrix3 dP;
+        for (int k = 0; k<3; k++) {
+            for (int j = 0; j<3; j++) {
+                dP(k,j) = dP_flat[3*k + j];
+            }
+        }
+        Matrix3x4<ElementScalar> out_i = dP*elements[i].D.transpose();
+        for (int j = 0; j<4; j++) {
+            productBuffers[b].template segment<3>(3*elements[i].indices[j]) += out_i.col(j).template cast<Scalar>();
+        }
+    });
     
-    return M_inv * rightHandSide;
+    out.noalias() = M*systemSolveTmp;
+    for (int b = 0; b<blocks; b++) {
+        out += h*h*productBuffers[b];
+    }
+    for (int c = 0; c<contactStiffnesses.size(); c++) {
+        const SurfaceContact<Scalar> &contact = surfaceCollision.contacts[c];
+        for (int j = 0; j<4 && contactStiffnesses[c] > 0; j++) {
+            int v = contact.vertices[j];
+            Scalar scale = h*h*contactStiffnesses[c]*contact.weights[j]*contact.weights[j];
+            out.template segment<3>(3*v) += scale*contact.normal.dot(systemSolveTmp.template segment<3>(3*v))*contact.normal;
+        }
+    }
+    // Normal velocities of held vertices only map to themselves.
+    projectContacts(out);
+    out += v - systemSolveTmp;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::applyPreconditioner(const VectorX &r, VectorX &z) {
+    for (int i = 0; i<n; i++) {
+        z.template segment<3>(3*i) = Eigen::Map<const Matrix3>(&preconditionerBlocks[9*i])*r.template segment<3>(3*i);
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+bool PhysicalMesh<Scalar, ElementScalar, Material>::solveSystem(VectorX &qq, const VectorX &b, VectorX &x) {
+    if (linearSolver == LinearSolver::Direct) {
+        if (Material<ElementScalar>::constantStiffness) {
+            if (restSystemTimeStep != h) {
+                factorizeRestSystem();
+            }
+            if (!contactVertices.empty() || !surfaceCollision.contacts.empty()) {
+                return solveRestSystem(qq, b, x);
+            }
+            solveLDLT(restSystemSolver, restSystemDiagonalInv, b, systemSolveTmp, x);
+            return restSystemSolver.info() == Eigen::Success;
+        }
+        factorizeSystem(qq);
+        solveLDLT(systemSolver, systemDiagonalInv, b, systemSolveTmp, x);
+        return systemSolver.info() == Eigen::Success;
+    }
+    if (linearSolver == LinearSolver::Multigrid || linearSolver == LinearSolver::MultigridCG) {
+        assembleSystem(qq);
+        multigrid.threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+#ifdef COUNT_ALLOCATIONS
+        // Levels and coarse patterns are built for the first matrix and for every new pattern, and the coarsest
+        // level is factorized like the direct system, these allocations are expected and still counted.
+        // Restricting the values of a known pattern doesn't allocate.
+        bool mallocAllowed = Eigen::internal::is_malloc_allowed();
+        Eigen::internal::set_is_malloc_allowed(mallocAllowed || !multigridBuilt || multigrid.patternChanged(A));
+#endif
+        if (!multigridBuilt) {
+            // Vertices are bound to the coarse grids in the pose of the first solve, usually close to rest.
+            multigrid.build(q, vertexEdgeLengths.mean());
+            multigridBuilt = true;
+        }
+        multigrid.update(A);
+#ifdef COUNT_ALLOCATIONS
+        Eigen::internal::set_is_malloc_allowed(true);
+#endif
+        multigrid.factorize();
+#ifdef COUNT_ALLOCATIONS
+        Eigen::internal::set_is_malloc_allowed(mallocAllowed);
+#endif
+        if (!multigrid.factorized()) {
+            return false;
+        }
+        if (linearSolver == LinearSolver::Multigrid) {
+            multigrid.solve(b, x, cg.tolerance, cg.maxIterations);
+            solverStats.linearIterations += multigrid.iterations;
+        } else {
+            cg.solve([&](const VectorX &v, VectorX &out) { multigrid.apply(v, out); },
+                     [&](const VectorX &r, VectorX &z) { multigrid.precondition(r, z); },
+                     b, x);
+            solverStats.linearIterations += cg.iterations;
+        }
+        return true;
+    }
+    linearizeSystem(qq);
+    cg.solve([&](const VectorX &v, VectorX &out) { applySystem(v, out); },
+             [&](const VectorX &r, VectorX &z) { applyPreconditioner(r, z); },
+             b, x);
+    solverStats.linearIterations += cg.iterations;
+    return true;
+}
+
+// Held vertices project the rest system and self-contacts add to its diagonal blocks as in applySystem. Conjugate
+// gradients on that system preconditioned with the factored rest system, projected the same way, converge in a few
+// iterations while contacts are a small part of the mesh, without assembling or factorizing anything.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+bool PhysicalMesh<Scalar, ElementScalar, Material>::solveRestSystem(VectorX &qq, const VectorX &b, VectorX &x) {
+    linearizeContacts(qq);
+    auto apply = [&](const VectorX &v, VectorX &out) {
+        systemSolveTmp = v;
+        projectContacts(systemSolveTmp);
+        out.noalias() = restSystem*systemSolveTmp;
+        for (int c = 0; c<contactStiffnesses.size(); c++) {
+            const SurfaceContact<Scalar> &contact = surfaceCollision.contacts[c];
+            for (int j = 0; j<4 && contactStiffnesses[c] > 0; j++) {
+                int v = contact.vertices[j];
+                Scalar scale = h*h*contactStiffnesses[c]*contact.weights[j]*contact.weights[j];
+                out.template segment<3>(3*v) += scale*contact.normal.dot(systemSolveTmp.template segment<3>(3*v))*contact.normal;
+            }
+        }
+        projectContacts(out);
+        out += v - systemSolveTmp;
+    };
+    auto precondition = [&](const VectorX &r, VectorX &z) {
+        systemSolveTmp = r;
+        projectContacts(systemSolveTmp);
+        solveLDLT(restSystemSolver, restSystemDiagonalInv, systemSolveTmp, restSolveTmp, z);
+        projectContacts(z);
+        z += r - systemSolveTmp;
+    };
+    cg.solve(apply, precondition, b, x);
+    solverStats.linearIterations += cg.iterations;
+    return restSystemSolver.info() == Eigen::Success;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::applyInverseMass(const VectorX &f, VectorX &a) {
+    if (massMatrix == MassMatrix::Lumped) {
+        a.array() = M_lumped_inv.array() * f.array();
+    } else {
+        solveLDLT(massSolver, massDiagonalInv, f, massSolveTmp, a);
+    }
+}
+
+// Updating q and q dot using forward Euler method.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::forwardEulerStep(VectorX &new_q_dot) {
+    f_tmp = -dVdQ(q);
+    applyInverseMass(f_tmp, new_q_dot);
+    new_q_dot = q_dot + h*new_q_dot;
+}
+
+// First kick of velocity Verlet, returns velocity at half step.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::velocityVerletStep(VectorX &new_q_dot) {
+    if (!accelerationValid) {
+        f_tmp = -dVdQ(q);
+        applyInverseMass(f_tmp, acceleration);
+    }
+    new_q_dot = q_dot + Scalar(0.5)*h*acceleration;
+}
+
+// Second kick of velocity Verlet after positions are updated with the half step velocity.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::velocityVerletFinish() {
+    f_tmp = -dVdQ(q);
+    applyInverseMass(f_tmp, acceleration);
+    accelerationValid = true;
+    q_dot = new_q_dot + Scalar(0.5)*h*acceleration;
 }
 
 // Updating q and q dot using backward Euler method.
-Eigen::VectorXf PhysicalMesh::backwardEulerLinearStep() {
-    Eigen::VectorXf f = -dVdQ(q);
-    SparseMatrixf K = -ddVddQ(q);
-    Eigen::SimplicialLDLT<SparseMatrixf> solverLDLT;
-    auto rightHandSide = (M * q_dot + h*f);
-    solverLDLT.compute(M + h*h*K);
-    return solverLDLT.solve(rightHandSide);
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::backwardEulerLinearStep(VectorX &new_q_dot) {
+    solverStats.linearIterations = 0;
+    contactNormals.setZero();
+    contactVertices.clear();
+    f_tmp = -dVdQ(q);
+    rightHandSide.noalias() = M * q_dot;
+    rightHandSide += h*f_tmp;
+    // Previous velocity is the initial guess of the iterative solver.
+    new_q_dot = q_dot;
+    solveSystem(q, rightHandSide, new_q_dot);
+}
+
+// Weights per unit volume of squared distances of F to the closest rotation and to the closest
+// volume preserving matrix, chosen to match a material with Lame parameters mu and lambda near rest.
+template<typename Scalar>
+Scalar projectiveStrainWeight(Scalar mu) {
+    return 2*mu;
+}
+
+template<typename Scalar>
+Scalar projectiveVolumeWeight(Scalar lambda) {
+    return 3*lambda;
 }
 
-Eigen::VectorXf PhysicalMesh::gradiendDescent(float a, float tol, bool verbose) {
-    Eigen::VectorXf v_i = q_dot;
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::factorizeProjectiveSystem() {
+    SparseAssembler<Scalar> assembler(n, elements);
+    ElementScalar w = projectiveStrainWeight(material.mu) + projectiveVolumeWeight(material.lambda);
+    for (int i = 0; i<n_tet; i++) {
+        Matrix9x12<ElementScalar> B_i = elements[i].B();
+        assembler.addElement(i, elements[i].volume*w*B_i.transpose()*B_i);
+    }
+    // M and the assembled matrix share the sparsity pattern.
+    projectiveMatrix = assembler.getMatrix();
+    projectiveMatrix.coeffs() += M.coeffs()/(h*h);
+    projectiveSolver.compute(projectiveMatrix);
+    projectiveDiagonalInv = projectiveSolver.vectorD().cwiseInverse();
+    projectiveTimeStep = h;
+}
+
+// Projective Dynamics step: positions minimize 1/(2h^2)*|x - y|_M^2 + sum of w_i/2*|F_i(x) - P_i|^2,
+// where y is the inertial position and P_i are projections of deformation gradients onto constraints.
+// Local step finds P_i for fixed x in parallel, global step finds x for fixed P_i with the prefactored matrix.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::projectiveDynamicsStep(VectorX &new_q_dot) {
+    if (projectiveTimeStep != h) {
+        factorizeProjectiveSystem();
+    }
+    ElementScalar w_strain = projectiveStrainWeight(material.mu);
+    ElementScalar w_volume = projectiveVolumeWeight(material.lambda);
+    
+    // M*y/h^2 with y = q + h*q_dot + h^2*M^-1*f_ext, gravity acts on every vertex with volume*g.
+    q_tmp = q + h*q_dot;
+    rightHandSide.noalias() = M*q_tmp;
+    rightHandSide /= h*h;
+    for (int i = 0; i<n_tet; i++) {
+        for (int k = 0; k<4; k++) {
+            rightHandSide[3*elements[i].indices[k] + 1] -= elements[i].volume*g;
+        }
+    }
+    
+    int blocks = loopBlocks();
+    productBuffers.resize(blocks);
+    for (int iteration = 0; iteration<projectiveIterations; iteration++) {
+        for (auto &buffer : productBuffers) {
+            buffer.setZero(3*n);
+        }
+        // Local step, adds w_i*B_i^T*P_i of every tetrahedron.
+        forEachTet([&](int i, int b) {
+            ElementMatrix3 F = getFMat(i, q_tmp);
+            Eigen::JacobiSVD<ElementMatrix3> svd(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+            ElementMatrix3 U = svd.matrixU();
+            Eigen::Matrix<ElementScalar, 3, 1> sigma = svd.singularValues();
+            // Closest rotation rather than reflection for inverted tetrahedra.
+            if ((U*svd.matrixV().transpose()).determinant() < 0) {
+                U.col(2) = -U.col(2);
+                sigma[2] = -sigma[2];
+            }
+            ElementMatrix3 R = U*svd.matrixV().transpose();
+            // Singular values scaled to unit product is an approximate projection onto det(F) = 1.
+            ElementScalar J = sigma.prod();
+            ElementMatrix3 F_volume = R;
+            if (J > 0) {
+                F_volume = U*(sigma/std::cbrt(J)).asDiagonal()*svd.matrixV().transpose();
+            }
+            ElementMatrix3 P = elements[i].volume*(w_strain*R + w_volume*F_volume);
+            Matrix3x4<ElementScalar> force_i = P*elements[i].D.transpose();
+            for (int j = 0; j<4; j++) {
+                productBuffers[b].template segment<3>(3*elements[i].indices[j]) += force_i.col(j).template cast<Scalar>();
+            }
+        });
+        
+        // Global step. Contact forces at the current iterate are added as external forces, which is only stable
+        // well below the inertia M/h^2 of the matrix, so they act with half the stiffness.
+        f_tmp = rightHandSide;
+        for (int b = 0; b<blocks; b++) {
+            f_tmp += productBuffers[b];
+        }
+        if (!surfaceCollision.contacts.empty()) {
+            massTmp.setZero();
+            addContactGradient(q_tmp, massTmp);
+            f_tmp -= Scalar(0.5)*massTmp;
+        }
+        solveLDLT(projectiveSolver, projectiveDiagonalInv, f_tmp, systemSolveTmp, q_tmp);
+    }
+    new_q_dot = (q_tmp - q)/h;
+}
+
+// Vertex block descent step: positions minimize 1/(2h^2)*|x - y|_M^2 + V(x) by Gauss-Seidel over vertices,
+// every vertex makes a Newton step on its own 3 coordinates with the others fixed.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::vertexBlockDescentStep(VectorX &new_q_dot) {
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    // Inertial positions y = q + h*q_dot + h^2*M^-1*f_ext, gravity acts on every vertex with volume*g.
+    rightHandSide = q + h*q_dot;
+    for (int i = 0; i<n_tet; i++) {
+        for (int k = 0; k<4; k++) {
+            int index = elements[i].indices[k];
+            rightHandSide[3*index + 1] -= h*h*elements[i].volume*g/vertexMasses[index];
+        }
+    }
+    q_tmp = rightHandSide;
+    
+    int n_colors = vertexColors.size();
+    const AlignedVector<SurfaceContact<Scalar>> &contacts = surfaceCollision.contacts;
+    for (int iteration = 0; iteration<blockDescentIterations; iteration++) {
+        // Contacts may couple vertices of the same color, those are read from positions at the start of the sweep.
+        if (!contacts.empty()) {
+            v_tmp = q_tmp;
+        }
+        // Colors are swept forward and backward in turns (symmetric Gauss-Seidel), otherwise the update order
+        // biases unconverged steps and resting meshes slowly slide.
+        for (int k = 0; k<n_colors; k++) {
+            const auto &color = vertexColors[iteration%2 == 0 ? k : n_colors - 1 - k];
+            int n_color = color.size();
+            #pragma omp parallel for num_threads(n_threads) schedule(static)
+            for (int c = 0; c<n_color; c++) {
+                int v = color[c];
+                Scalar inertia = vertexMasses[v]/(h*h);
+                Vector3 force = -inertia*(q_tmp.template segment<3>(3*v) - rightHandSide.template segment<3>(3*v));
+                Matrix3 hessian = inertia*Matrix3::Identity();
+                for (int t = vertexTetOffsets[v]; t<vertexTetOffsets[v + 1]; t++) {
+                    int i = vertexTets[t]/4;
+                    int corner = vertexTets[t]%4;
+                    Vector9<ElementScalar> ff_i = getFFlat(i, q_tmp);
+                    Vector9<ElementScalar> gradPsi_i;
+                    Matrix9<ElementScalar> hessPsi_i;
+                    evaluateTet(i, ff_i, nullptr, &gradPsi_i, &hessPsi_i);
+                    Eigen::Matrix<ElementScalar, 9, 3> B_k = elements[i].B(corner);
+                    force -= (elements[i].volume*B_k.transpose()*gradPsi_i).template cast<Scalar>();
+                    hessian += (elements[i].volume*B_k.transpose()*hessPsi_i*B_k).template cast<Scalar>();
+                }
+                for (int t = surfaceCollision.vertexContactOffsets[v]; t<surfaceCollision.vertexContactOffsets[v + 1]; t++) {
+                    const SurfaceContact<Scalar> &contact = contacts[surfaceCollision.vertexContacts[t]/4];
+                    Scalar w = contact.weights[surfaceCollision.vertexContacts[t]%4];
+                    Vector3 x = Vector3::Zero();
+                    for (int j = 0; j<4; j++) {
+                        int u = contact.vertices[j];
+                        const VectorX &positions = u != v && vertexColor[u] == vertexColor[v] ? v_tmp : q_tmp;
+                        x += contact.weights[j]*positions.template segment<3>(3*u);
+                    }
+                    Scalar gap = contact.normal.dot(x) - collisionThickness;
+                    if (gap < 0) {
+                        Scalar k = contactStiffness(contact);
+                        force -= k*gap*w*contact.normal;
+                        hessian += k*w*w*contact.normal*contact.normal.transpose();
+                    }
+                }
+                // Vertices with an indefinite block are left in place until their neighbours move.
+                Eigen::LLT<Matrix3> llt(hessian);
+                if (llt.info() == Eigen::Success) {
+                    Vector3 dx = llt.solve(force);
+                    // Obstacles are a constraint on the position. A step ending inside is solved again with
+                    // the linearized surface n*dx = n*dx_0 - distance as an equality constraint.
+                    Vector3 normal;
+                    Scalar distance = obstacleDistance(q_tmp.template segment<3>(3*v) + dx, normal);
+                    if (distance < 0) {
+                        Vector3 w = llt.solve(normal);
+                        dx -= distance/normal.dot(w)*w;
+                    }
+                    if (dx.allFinite()) {
+                        q_tmp.template segment<3>(3*v) += dx;
+                    }
+                }
+            }
+        }
+    }
+    new_q_dot = (q_tmp - q)/h;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::computeModes(int count, int derivativeModes) {
+    typedef Eigen::SparseMatrix<double> SparseMatrixd;
+    modeRestPositions = q;
+    SparseMatrixd K = ddVddQ(q).template cast<double>();
+    SparseMatrixd mass = M.template cast<double>();
+    ModalBasis<double> basis;
+    basis.compute(K, mass, count);
+    
+    // Modal derivative of modes u_i, u_j solves K*Psi_ij = -(dK/du_j)*u_i, the derivative of the stiffness is
+    // taken by central differences. Rigid modes have eigenvalues at round-off level and no derivatives.
+    if (derivativeModes > 0) {
+        double rigid = 1e-6*K.diagonal().sum()/mass.diagonal().sum();
+        std::vector<int> elastic;
+        for (int k = 0; k<basis.eigenvalues.size() && (int)elastic.size()<derivativeModes; k++) {
+            if (basis.eigenvalues[k] > rigid) {
+                elastic.push_back(k);
+            }
+        }
+        int m = elastic.size();
+        Eigen::MatrixXd derivatives(K.rows(), m*(m + 1)/2);
+        int column = 0;
+        for (int j = 0; j<m; j++) {
+            VectorX u_j = basis.modes.col(elastic[j]).template cast<Scalar>();
+            // Largest vertex displacement of a thousandth of a mean rest edge.
+            Scalar epsilon = Scalar(1e-3)*vertexEdgeLengths.mean()/u_j.cwiseAbs().maxCoeff();
+            q_tmp = q + epsilon*u_j;
+            SparseMatrixd dK = ddVddQ(q_tmp).template cast<double>();
+            q_tmp = q - epsilon*u_j;
+            dK -= ddVddQ(q_tmp).template cast<double>();
+            dK /= 2*epsilon;
+            for (int i = 0; i<=j; i++) {
+                derivatives.col(column++) = -basis.solveShifted(dK*basis.modes.col(elastic[i]));
+            }
+        }
+        basis.addVectors(derivatives);
+    }
+    
+    modes = basis.modes.template cast<Scalar>();
+    modeEigenvalues = basis.eigenvalues.template cast<Scalar>();
+    modalNonlinear = modes.cols() > modeEigenvalues.size();
+    long r = modes.cols();
+    // Gravity acts on every vertex with volume*g, same as in V.
+    v_tmp.setZero(3*n);
+    for (int i = 0; i<n_tet; i++) {
+        for (int k = 0; k<4; k++) {
+            v_tmp[3*elements[i].indices[k] + 1] += elements[i].volume*g;
+        }
+    }
+    modalForces.noalias() = -modes.transpose()*v_tmp;
+    modalCoordinates.setZero(r);
+    modalVelocities.setZero(r);
+    modalTrial.setZero(r);
+    modalVelocity.setZero(r);
+    modalTrialVelocity.setZero(r);
+    modalGradient.setZero(r);
+    modalTrialGradient.setZero(r);
+    modalDirection.setZero(r);
+    modalHessian.setZero(r, r);
+    // Reduced forces are summed over all tetrahedra until a cubature is computed.
+    std::vector<int> tets(n_tet);
+    for (int i = 0; i<n_tet; i++) {
+        tets[i] = i;
+    }
+    setModalTets(tets, std::vector<Scalar>(n_tet, 1));
+}
+
+// Identifies the basis, the mesh, the material and the training parameters a cubature cache was built for
+// (FNV-1a over their bytes).
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+uint64_t PhysicalMesh<Scalar, ElementScalar, Material>::cubatureChecksum(int poses, Scalar tolerance, int maxTets) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](const void *data, size_t size) {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t k = 0; k<size; k++) {
+            hash = (hash ^ bytes[k])*1099511628211ull;
+        }
+    };
+    add(modes.data(), modes.size()*sizeof(Scalar));
+    add(modeRestPositions.data(), modeRestPositions.size()*sizeof(Scalar));
+    for (const Element &element : elements) {
+        add(element.indices.data(), 4*sizeof(int));
+    }
+    add(Material<ElementScalar>::name(), std::strlen(Material<ElementScalar>::name()));
+    add(&material.mu, sizeof(material.mu));
+    add(&material.lambda, sizeof(material.lambda));
+    add(&poses, sizeof(poses));
+    add(&tolerance, sizeof(tolerance));
+    add(&maxTets, sizeof(maxTets));
+    return hash;
+}
+
+// Training poses are random combinations of the basis columns, every column with an amplitude inversely
+// proportional to the square root of its stiffness so that soft columns move most. Reduced elastic forces of
+// every tetrahedron on every pose form the columns of the training matrix, rows of one pose are scaled by the
+// norm of its full reduced force so that all poses count the same.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::computeCubature(const std::string &cachePath, int poses, Scalar tolerance, int maxTets) {
+    if (modes.cols() == 0) {
+        computeModes(30);
+    }
+    long r = modes.cols();
+    uint64_t key = cubatureChecksum(poses, tolerance, maxTets);
+    Cubature cubature;
+    if (cachePath.empty() || !cubature.load(cachePath, key, n_tet)) {
+        // Stiffness of every column, rigid ones stay at rest.
+        SparseMatrix &K = ddVddQ(modeRestPositions);
+        VectorX stiffness(r);
+        for (long j = 0; j<r; j++) {
+            v_tmp.noalias() = K*modes.col(j);
+            stiffness[j] = modes.col(j).dot(v_tmp);
+        }
+        Scalar rigid = Scalar(1e-6)*K.diagonal().sum()/M.diagonal().sum();
+        Scalar softest = std::numeric_limits<Scalar>::max();
+        for (long j = 0; j<r; j++) {
+            if (stiffness[j] > rigid) {
+                softest = std::min(softest, stiffness[j]);
+            }
+        }
+        // Softest column moves vertices by up to a tenth of the mesh size.
+        Vector3 lower = Vector3::Constant(std::numeric_limits<Scalar>::max());
+        Vector3 upper = Vector3::Constant(std::numeric_limits<Scalar>::lowest());
+        for (int i = 0; i<n; i++) {
+            lower = lower.cwiseMin(modeRestPositions.template segment<3>(3*i));
+            upper = upper.cwiseMax(modeRestPositions.template segment<3>(3*i));
+        }
+        Scalar size = (upper - lower).norm();
+        VectorX amplitudes = VectorX::Zero(r);
+        for (long j = 0; j<r; j++) {
+            if (stiffness[j] > rigid) {
+                amplitudes[j] = Scalar(0.1)*size*std::sqrt(softest/stiffness[j])/modes.col(j).cwiseAbs().maxCoeff();
+            }
+        }
+        
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(poses*r, n_tet);
+        Eigen::VectorXd b(poses*r);
+        std::mt19937 random(0);
+        std::normal_distribution<double> normal;
+        int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+        for (int p = 0; p<poses; p++) {
+            VectorX z(r);
+            for (long j = 0; j<r; j++) {
+                z[j] = amplitudes[j]*(Scalar)normal(random);
+            }
+            // Poses that invert tetrahedra have no finite forces, they are scaled down until they don't.
+            for (int attempt = 0; attempt<10; attempt++) {
+                q_tmp = modeRestPositions;
+                q_tmp.noalias() += modes*z;
+                bool finite = true;
+                #pragma omp parallel for num_threads(n_threads) schedule(static) reduction(&&:finite)
+                for (int i = 0; i<n_tet; i++) {
+                    Vector9<ElementScalar> dpsi;
+                    material.evaluate(getFFlat(i, q_tmp), nullptr, &dpsi, nullptr);
+                    Vector12<Scalar> g_i = (elements[i].volume*(elements[i].B().transpose()*dpsi)).template cast<Scalar>();
+                    for (int k = 0; k<4; k++) {
+                        A.block(p*r, i, r, 1) += (modes.template middleRows<3>(3*elements[i].indices[k]).transpose()*
+                                                  g_i.template segment<3>(3*k)).template cast<double>();
+                    }
+                    finite = finite && g_i.allFinite();
+                }
+                if (finite) {
+                    break;
+                }
+                A.block(p*r, 0, r, n_tet).setZero();
+                z *= Scalar(0.5);
+            }
+            b.segment(p*r, r) = A.block(p*r, 0, r, n_tet).rowwise().sum();
+            double norm = b.segment(p*r, r).norm();
+            if (norm > 0) {
+                A.block(p*r, 0, r, n_tet) /= norm;
+                b.segment(p*r, r) /= norm;
+            }
+        }
+        cubature.train(A, b, tolerance, maxTets);
+        if (!cachePath.empty()) {
+            cubature.save(cachePath, key);
+        }
+    }
+    cubatureError = cubature.error;
+    setModalTets(cubature.tets, std::vector<Scalar>(cubature.weights.begin(), cubature.weights.end()));
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::setModalTets(const std::vector<int> &tets, const std::vector<Scalar> &weights) {
+    long r = modes.cols();
+    long samples = tets.size();
+    modalTets = tets;
+    modalTetWeights = weights;
+    modalTetJacobians.setZero(9*samples, r);
+    modalTetRest.setZero(9*samples);
+    // Row 3*a + b of F = sum over vertices k of x_k*D.row(k) is F(a, b).
+    for (long s = 0; s<samples; s++) {
+        const Element &element = elements[tets[s]];
+        for (int k = 0; k<4; k++) {
+            int index = element.indices[k];
+            for (int a = 0; a<3; a++) {
+                for (int b = 0; b<3; b++) {
+                    Scalar d = element.D(k, b);
+                    modalTetJacobians.row(9*s + 3*a + b) += d*modes.row(3*index + a);
+                    modalTetRest[9*s + 3*a + b] += d*modeRestPositions[3*index + a];
+                }
+            }
+        }
+    }
+}
+
+// Deformation gradient of a tetrahedron is its rest one plus its 9 rows of B*U times zz, the rest of the mesh
+// is not expanded. Reduced forces are (B*U_s)^T*dpsi and the reduced Hessian (B*U_s)^T*H*(B*U_s): the H*(B*U_s)
+// of consecutive tetrahedra are stacked and multiplied by their stacked rows at once, lower triangle only since
+// the solver reads no more. Stacks are as deep as Eigen's product buffers allow on the stack.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::modalElementTerms(const VectorX &zz, Scalar *energy, VectorX *grad, MatrixX *hess) {
+    long r = modes.cols();
+    long samples = modalTets.size();
+    int blocks = std::max(1, (int)std::min((long)reductionBlocks, samples));
+    modalEnergyBuffers.resize(blocks);
+    modalGradientBuffers.resize(blocks);
+    modalHessianBuffers.resize(blocks);
+    modalGatherBuffers.resize(blocks);
+    long stack = std::max(1L, (long)(EIGEN_STACK_ALLOCATION_LIMIT/(4*9*r*sizeof(Scalar))));
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+    for (int b = 0; b<blocks; b++) {
+        Scalar blockEnergy = 0;
+        VectorX &blockGradient = modalGradientBuffers[b];
+        MatrixX &blockHessian = modalHessianBuffers[b];
+        MatrixX &HJ = modalGatherBuffers[b];
+        long first = samples*b/blocks;
+        long last = samples*(b + 1)/blocks;
+        if (grad != nullptr) {
+            blockGradient.setZero(r);
+        }
+        if (hess != nullptr) {
+            blockHessian.setZero(r, r);
+            HJ.resize(9*stack, r);
+        }
+        for (long s = first; s<last; s++) {
+            const Element &element = elements[modalTets[s]];
+            Scalar weight = modalTetWeights[s]*element.volume;
+            auto J_s = modalTetJacobians.template middleRows<9>(9*s);
+            Vector9<Scalar> f_s = modalTetRest.template segment<9>(9*s);
+            f_s.noalias() += J_s*zz;
+            Vector9<ElementScalar> f = f_s.template cast<ElementScalar>();
+            ElementScalar psi = 0;
+            Vector9<ElementScalar> dpsi;
+            Matrix9<ElementScalar> ddpsi;
+            material.evaluate(f, energy != nullptr ? &psi : nullptr, grad != nullptr ? &dpsi : nullptr,
+                              hess != nullptr ? &ddpsi : nullptr);
+            blockEnergy += weight*psi;
+            if (grad != nullptr) {
+                blockGradient.noalias() += J_s.transpose()*(weight*dpsi.template cast<Scalar>());
+            }
+            if (hess != nullptr) {
+                long stacked = (s - first)%stack;
+                HJ.template middleRows<9>(9*stacked).noalias() = (weight*ddpsi.template cast<Scalar>())*J_s;
+                if (stacked + 1 == stack || s + 1 == last) {
+                    blockHessian.template triangularView<Eigen::Lower>() +=
+                        modalTetJacobians.middleRows(9*(s - stacked), 9*(stacked + 1)).transpose()*HJ.topRows(9*(stacked + 1));
+                }
+            }
+        }
+        modalEnergyBuffers[b] = blockEnergy;
+    }
+    if (energy != nullptr) {
+        *energy = 0;
+        for (int b = 0; b<blocks; b++) {
+            *energy += modalEnergyBuffers[b];
+        }
+    }
+    if (grad != nullptr) {
+        *grad = modalGradientBuffers[0];
+        for (int b = 1; b<blocks; b++) {
+            *grad += modalGradientBuffers[b];
+        }
+    }
+    if (hess != nullptr) {
+        *hess = modalHessianBuffers[0];
+        for (int b = 1; b<blocks; b++) {
+            *hess += modalHessianBuffers[b];
+        }
+    }
+}
+
+// Gravity is linear in positions, its reduced energy is -modalForces*z up to a constant. The gradient, when
+// grad is given, comes from the same pass over the tetrahedra.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::modalEnergy(const VectorX &v, VectorX *grad) {
+    modalTrial = modalCoordinates + h*v;
+    Scalar elastic = 0;
+    modalElementTerms(modalTrial, &elastic, grad, nullptr);
+    if (grad != nullptr) {
+        *grad -= modalForces;
+        *grad *= h;
+        *grad += v - modalVelocities;
+    }
+    return Scalar(0.5)*(v - modalVelocities).squaredNorm() + elastic - modalForces.dot(modalTrial);
+}
+
+// Backward Euler in modal coordinates. Columns of the basis are M-orthonormal, so the reduced mass is the identity.
+// Coordinates are the M-orthogonal projection of the current state, switching integrators or restoring a state
+// needs no bookkeeping. Vibration modes alone are integrated mode by mode with the stiffness at rest, with modal
+// derivatives the reduced incremental potential is minimized with Newton's method.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::modalStep(VectorX &new_q_dot) {
+    if (modes.cols() == 0) {
+        computeModes(30);
+    }
+    v_tmp = q - modeRestPositions;
+    massTmp.noalias() = M*v_tmp;
+    modalCoordinates.noalias() = modes.transpose()*massTmp;
+    massTmp.noalias() = M*q_dot;
+    modalVelocities.noalias() = modes.transpose()*massTmp;
+    
+    solverStats.iterations = 0;
+    solverStats.linearIterations = 0;
+    solverStats.residuals.clear();
+    solverStats.converged = true;
+    if (!modalNonlinear) {
+        for (long k = 0; k<modes.cols(); k++) {
+            Scalar lambda = modeEigenvalues[k];
+            modalVelocity[k] = (modalVelocities[k] + h*(modalForces[k] - lambda*modalCoordinates[k]))/(1 + h*h*lambda);
+        }
+    } else {
+        solverStats.converged = false;
+        // Every trial of the line search evaluates energy and gradient in one pass, the accepted one gives
+        // the gradient of the next iteration, which only adds a pass for the Hessian.
+        modalVelocity = modalVelocities;
+        Scalar energy = modalEnergy(modalVelocity, &modalGradient);
+        for (int k = 0; ; k++) {
+            VectorX &grad = modalGradient;
+            Scalar residual = grad.norm();
+            solverStats.residuals.push_back(residual);
+            if (residual <= newtonTolerance*solverStats.residuals[0] || residual < Scalar(1e-7)) {
+                solverStats.converged = true;
+                break;
+            }
+            if (k == newtonMaxIterations) {
+                break;
+            }
+            modalTrial = modalCoordinates + h*modalVelocity;
+            modalElementTerms(modalTrial, nullptr, nullptr, &modalHessian);
+            modalHessian *= h*h;
+            modalHessian.diagonal().array() += 1;
+            modalSolver.compute(modalHessian);
+            modalDirection = -grad;
+            modalSolver.solveInPlace(modalDirection);
+            Scalar slope = grad.dot(modalDirection);
+            if (modalSolver.info() != Eigen::Success || !(slope < 0)) {
+                modalDirection = -grad;
+                slope = -residual*residual;
+            }
+            
+            // Same backtracking as the full Newton step.
+            Scalar alpha = 1;
+            Scalar newEnergy = energy;
+            for (int j = 0; j<30 && std::isfinite(energy); j++) {
+                modalTrialVelocity = modalVelocity + alpha*modalDirection;
+                newEnergy = modalEnergy(modalTrialVelocity, &modalTrialGradient);
+                if (newEnergy <= energy + Scalar(1e-4)*alpha*slope + Scalar(1e-6)*std::abs(energy)) {
+                    break;
+                }
+                alpha *= Scalar(0.5);
+            }
+            if (std::isfinite(energy) && !(newEnergy <= energy + Scalar(1e-6)*std::abs(energy))) {
+                break;
+            }
+            modalVelocity += alpha*modalDirection;
+            modalGradient.swap(modalTrialGradient);
+            energy = newEnergy;
+            solverStats.iterations++;
+        }
+    }
+    
+    // Vertices that would end inside an obstacle get the normal velocity that takes them to its surface.
+    // The correction is projected on the modes, which spreads it over the mesh, and repeated a few times.
+    for (int iteration = 0; iteration<4 && !obstacles.empty(); iteration++) {
+        new_q_dot.noalias() = modes*modalVelocity;
+        q_tmp = q + h*new_q_dot;
+        queryObstacles(q_tmp);
+        v_tmp.setZero();
+        bool hit = false;
+        for (int i = 0; i<n; i++) {
+            if (obstacleDistances[i] < 0) {
+                v_tmp.template segment<3>(3*i) = -obstacleDistances[i]/h*obstacleNormals.template segment<3>(3*i);
+                hit = true;
+            }
+        }
+        if (!hit) {
+            break;
+        }
+        massTmp.noalias() = M*v_tmp;
+        modalVelocity.noalias() += modes.transpose()*massTmp;
+    }
+    
+    // Expanding the new coordinates, the velocity moves q exactly there.
+    modalCoordinates += h*modalVelocity;
+    q_tmp = modeRestPositions;
+    q_tmp.noalias() += modes*modalCoordinates;
+    new_q_dot = (q_tmp - q)/h;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::bindSkin() {
+    TetGrid<Scalar, ElementScalar> grid(elements, q);
+    int n_skin = skinMesh.positions.size();
+    std::vector<int> skinTet(n_skin);
+    int n_threads = resolveThreadCount(threads);
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 256)
+    for (int j = 0; j<n_skin; j++) {
+        skinTet[j] = grid.locate(skinMesh.positions[j].cast<Scalar>());
+    }
+    
+    // Flat skinning tables sorted by tetrahedron, so skinning reads q in order.
+    // Vertices outside the mesh extrapolate the deformation of the closest tetrahedron.
+    skinVertices.clear();
+    for (int j = 0; j<n_skin; j++) {
+        if (skinTet[j] >= 0) {
+            skinVertices.push_back(j);
+        }
+    }
+    std::stable_sort(skinVertices.begin(), skinVertices.end(), [&](int a, int b) { return skinTet[a] < skinTet[b]; });
+    skinTets.resize(skinVertices.size());
+    skinWeights.resize(4*skinVertices.size());
+    for (int k = 0; k<skinVertices.size(); k++) {
+        int j = skinVertices[k];
+        skinTets[k] = skinTet[j];
+        Eigen::Map<Vector4> weights(&skinWeights[4*k]);
+        weights = grid.barycentric(skinTet[j], skinMesh.positions[j].cast<Scalar>());
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::obstacleDistance(const Vector3 &p, Vector3 &normal) const {
+    Scalar best = std::numeric_limits<Scalar>::max();
+    for (const SignedDistanceField *obstacle : obstacles) {
+        // Fields are single precision, queries are rounded to it.
+        Eigen::Vector3f obstacleNormal;
+        Scalar distance = obstacle->distance(p.template cast<float>(), obstacleNormal);
+        if (distance < best) {
+            best = distance;
+            normal = obstacleNormal.cast<Scalar>();
+        }
+    }
+    return best;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::queryObstacles(const VectorX &qq) {
+    if (obstacles.empty()) {
+        return;
+    }
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    #pragma omp parallel for num_threads(n_threads) schedule(static)
+    for (int i = 0; i<n; i++) {
+        Vector3 normal = Vector3::Zero();
+        obstacleDistances[i] = obstacleDistance(qq.template segment<3>(3*i), normal);
+        obstacleNormals.template segment<3>(3*i) = normal;
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+bool PhysicalMesh<Scalar, ElementScalar, Material>::holdAtObstacles(VectorX &v) {
+    if (obstacles.empty()) {
+        return false;
+    }
+    q_tmp = q + h*v;
+    queryObstacles(q_tmp);
+    bool changed = false;
+    for (int i = 0; i<n; i++) {
+        if (obstacleDistances[i] <= 0 && contactNormals.template segment<3>(3*i).isZero()) {
+            Vector3 normal = obstacleNormals.template segment<3>(3*i);
+            contactVertices.push_back(i);
+            contactNormals.template segment<3>(3*i) = normal;
+            v.template segment<3>(3*i) -= normal.dot(v.template segment<3>(3*i))*normal;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::detectSelfCollisions() {
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    surfaceCollision.detect(q, q_dot, h, collisionThickness, n_threads);
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::contactGap(const SurfaceContact<Scalar> &contact, const VectorX &qq) const {
+    Vector3 x = Vector3::Zero();
+    for (int j = 0; j<4; j++) {
+        x += contact.weights[j]*qq.template segment<3>(3*contact.vertices[j]);
+    }
+    return contact.normal.dot(x) - collisionThickness;
+}
+
+// Stiffness over the effective mass of the contact, sum of w_j^2/m_j, is collisionStiffness/h^2 whatever
+// the masses of the vertex and the triangle are.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::contactStiffness(const SurfaceContact<Scalar> &contact) const {
+    Scalar inverseMass = 0;
+    for (int j = 0; j<4; j++) {
+        inverseMass += contact.weights[j]*contact.weights[j]/vertexMasses[contact.vertices[j]];
+    }
+    return collisionStiffness/(h*h*inverseMass);
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+Scalar PhysicalMesh<Scalar, ElementScalar, Material>::contactEnergy(const VectorX &qq) {
+    Scalar energy = 0;
+    for (const SurfaceContact<Scalar> &contact : surfaceCollision.contacts) {
+        Scalar gap = std::min(contactGap(contact, qq), Scalar(0));
+        energy += Scalar(0.5)*contactStiffness(contact)*gap*gap;
+    }
+    return energy;
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::addContactGradient(const VectorX &qq, VectorX &grad) {
+    for (const SurfaceContact<Scalar> &contact : surfaceCollision.contacts) {
+        Scalar gap = contactGap(contact, qq);
+        if (gap < 0) {
+            Scalar k = contactStiffness(contact);
+            for (int j = 0; j<4; j++) {
+                grad.template segment<3>(3*contact.vertices[j]) += k*gap*contact.weights[j]*contact.normal;
+            }
+        }
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::linearizeContacts(const VectorX &qq) {
+    contactStiffnesses.resize(surfaceCollision.contacts.size());
+    for (int c = 0; c<contactStiffnesses.size(); c++) {
+        const SurfaceContact<Scalar> &contact = surfaceCollision.contacts[c];
+        contactStiffnesses[c] = contactGap(contact, qq) < 0 ? contactStiffness(contact) : 0;
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::projectContacts(VectorX &v) {
+    for (int i : contactVertices) {
+        Vector3 normal = contactNormals.template segment<3>(3*i);
+        v.template segment<3>(3*i) -= normal.dot(v.template segment<3>(3*i))*normal;
+    }
+}
+
+// Backward Euler step as minimization of E(v) = 1/2*(v - q_dot)^T*M*(v - q_dot) + V(q + h*v)
+// with Newton's method and backtracking line search.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::newtonStep(VectorX &new_q_dot) {
+    solverStats.iterations = 0;
+    solverStats.linearIterations = 0;
+    solverStats.residuals.clear();
+    solverStats.converged = false;
+    
+    // Previous velocity is the initial guess, unless it moves the mesh into an inverted state,
+    // contacts with obstacles may do this. Staying in place is the next guess.
+    new_q_dot = q_dot;
+    contactNormals.setZero();
+    contactVertices.clear();
+    holdAtObstacles(new_q_dot);
+    Scalar energy = E(new_q_dot);
+    if (!std::isfinite(energy)) {
+        new_q_dot.setZero();
+        energy = E(new_q_dot);
+    }
+    for (int k = 0; ; k++) {
+        VectorX &grad = dEdV(new_q_dot);
+        projectContacts(grad);
+        Scalar residual = grad.norm();
+        solverStats.residuals.push_back(residual);
+        if (residual <= newtonTolerance*solverStats.residuals[0] || residual < Scalar(1e-7)) {
+            // Converged velocities may take more vertices into obstacles, they are held and the solve goes on.
+            if (!holdAtObstacles(new_q_dot)) {
+                solverStats.converged = true;
+                break;
+            }
+            energy = E(new_q_dot);
+            if (k == newtonMaxIterations) {
+                break;
+            }
+            continue;
+        }
+        if (k == newtonMaxIterations) {
+            break;
+        }
+        
+        q_tmp = q + h*new_q_dot;
+        direction.setZero();
+        bool solved = solveSystem(q_tmp, grad, direction);
+        direction = -direction;
+        projectContacts(direction);
+        Scalar slope = grad.dot(direction);
+        // Hessian of the energy is not positive definite far from rest, fall back to steepest descent.
+        if (!solved || !(slope < 0)) {
+            direction = -grad;
+            slope = -residual*residual;
+        }
+        
+        // Backtracking until the energy decreases enough (Armijo condition).
+        // Inverted tetrahedra give NaN energy and are rejected as well.
+        // If the current state is inverted already, the energy can't be compared and the full step is taken.
+        Scalar alpha = 1;
+        Scalar newEnergy = energy;
+        for (int j = 0; j<30 && std::isfinite(energy); j++) {
+            trialVelocity = new_q_dot + alpha*direction;
+            newEnergy = E(trialVelocity);
+            if (newEnergy <= energy + Scalar(1e-4)*alpha*slope + Scalar(1e-6)*std::abs(energy)) {
+                break;
+            }
+            alpha *= Scalar(0.5);
+        }
+        if (std::isfinite(energy) && !(newEnergy <= energy + Scalar(1e-6)*std::abs(energy))) {
+            break;
+        }
+        new_q_dot += alpha*direction;
+        energy = newEnergy;
+        solverStats.iterations++;
+    }
+}
+
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::gradiendDescent(Scalar a, Scalar tol, bool verbose, VectorX &new_q_dot) {
+    new_q_dot = q_dot;
     
     for(int i = 0; i< 100; i++){
-        Eigen::VectorXf g_i = dEdV(v_i);
+        VectorX &g_i = dEdV(new_q_dot);
         if(verbose) {
             std::cout << "i: " << i << "g: " << g_i.norm() << std::endl;
         }
@@ -107,25 +1400,159 @@ Eigen::VectorXf PhysicalMesh::gradiendDescent(float a, float tol, bool verbose)
             break;
         }
         
-        Eigen::VectorXf d = -g_i;
-        v_i += a*d;
+        new_q_dot -= a*g_i;
     }
-    return v_i;
 }
 
 
-void PhysicalMesh::simulationStep() {
-    Eigen::VectorXf new_q_dot = forwardEulerStep();
-    //Eigen::VectorXf new_q_dot = gradiendDescent(20.0f, 0.0009f, false);
-    //Eigen::VectorXf new_q_dot = backwardEulerLinearStep();
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::simulationStep() {
+#ifdef COUNT_ALLOCATIONS
+    long allocations = allocationCount();
+    // Eigen asserts on heap allocations once the buffers are warmed up.
+    Eigen::internal::set_is_malloc_allowed(steps == 0);
+#endif
+    if (selfCollision) {
+        detectSelfCollisions();
+    }
+    switch (integrator) {
+        case Integrator::ForwardEuler:
+            forwardEulerStep(new_q_dot);
+            break;
+        case Integrator::VelocityVerlet:
+            velocityVerletStep(new_q_dot);
+            break;
+        case Integrator::BackwardEulerLinear:
+            backwardEulerLinearStep(new_q_dot);
+            break;
+        case Integrator::GradientDescent:
+            gradiendDescent(20, Scalar(0.0009), false, new_q_dot);
+            break;
+        case Integrator::Newton:
+            newtonStep(new_q_dot);
+            break;
+        case Integrator::ProjectiveDynamics:
+            projectiveDynamicsStep(new_q_dot);
+            break;
+        case Integrator::VertexBlockDescent:
+            vertexBlockDescentStep(new_q_dot);
+            break;
+        case Integrator::Modal:
+            modalStep(new_q_dot);
+            break;
+    }
     
-    for (int i = 0; i<n; i++) {
-        if((q + h * new_q_dot)[3*i + 1] <= -3){
-            new_q_dot[3*i + 1] = 0;
+    // Vertices that would end inside an obstacle lose the velocity towards it and stop at the surface.
+    // The modal step does this in the span of its modes.
+    if (!obstacles.empty() && integrator != Integrator::Modal) {
+        q_tmp = q + h*new_q_dot;
+        queryObstacles(q_tmp);
+        for (int i = 0; i<n; i++) {
+            Vector3 normal = obstacleNormals.template segment<3>(3*i);
+            Scalar normalVelocity = normal.dot(new_q_dot.template segment<3>(3*i));
+            if (obstacleDistances[i] <= 0 && normalVelocity < 0) {
+                new_q_dot.template segment<3>(3*i) -= normalVelocity*normal;
+            }
         }
     }
     q += h * new_q_dot;
-    q_dot = new_q_dot;
+    if (integrator == Integrator::VelocityVerlet) {
+        velocityVerletFinish();
+    } else {
+        q_dot = new_q_dot;
+    }
+    steps++;
+#ifdef COUNT_ALLOCATIONS
+    Eigen::internal::set_is_malloc_allowed(true);
+    lastStepAllocations = allocationCount() - allocations;
+#endif
+}
+
+// Substeps are accepted when their error estimates are within tolerance, otherwise the state is restored and
+// the substep is redone shorter. Estimates grow between linearly and quadratically with h, so the next step
+// is scaled by 0.9/sqrt(error), between 1/5 and 2 times the last one.
+template<typename Scalar, typename ElementScalar, template<typename> class Material>
+void PhysicalMesh<Scalar, ElementScalar, Material>::advance(Scalar frameTime) {
+    timeStepStats.substeps = 0;
+    timeStepStats.rejected = 0;
+    if (nextTimeStep <= 0) {
+        nextTimeStep = std::min(std::max(h, minTimeStep), maxTimeStep);
+        nextLimit = TimeStepLimit::MaxStep;
+    }
+    int n_threads = elementLoop == ElementLoop::Serial ? 1 : resolveThreadCount(threads);
+    Scalar kinetic = 0;
+    Scalar energy = totalEnergy(kinetic);
+    Scalar remaining = frameTime;
+    while (remaining > 0) {
+        // Equal substeps to the end of the frame, none longer than the proposed one. Steps stay the same
+        // while the proposal does, so factorizations that depend on h are reused.
+        int count = std::max(1, (int)std::ceil(remaining/nextTimeStep - Scalar(1e-3)));
+        Scalar step = count == 1 ? remaining : remaining/count;
+        TimeStepLimit limit = step == frameTime && step < nextTimeStep ? TimeStepLimit::FrameEnd : nextLimit;
+        if (step != h) {
+            setTimeStep(step);
+        }
+        q_saved = q;
+        q_dot_saved = q_dot;
+        simulationStep();
+        
+        Scalar displacementError = 0;
+        #pragma omp parallel for num_threads(n_threads) schedule(static) reduction(max:displacementError)
+        for (int v = 0; v<n; v++) {
+            Scalar moved = (q.template segment<3>(3*v) - q_saved.template segment<3>(3*v)).norm();
+            displacementError = std::max(displacementError, moved/(maxDisplacement*vertexEdgeLengths[v]));
+        }
+        Scalar newKinetic = 0;
+        Scalar newEnergy = totalEnergy(newKinetic);
+        // Only growth of the energy is an error, dissipation of implicit integrators and contacts is not.
+        // An inverted start state has no finite energy to compare with.
+        Scalar energyError = 0;
+        if (std::isfinite(energy)) {
+            energyError = std::max(Scalar(0), newEnergy - energy)/(maxEnergyDrift*(kinetic + newKinetic + energyFloor) + Scalar(1e-12));
+        }
+        Scalar residualError = 0;
+        if (integrator == Integrator::Newton && !solverStats.converged && !solverStats.residuals.empty()) {
+            residualError = solverStats.residuals.back()/(newtonTolerance*solverStats.residuals[0]);
+        }
+        
+        Scalar error = std::max({residualError, energyError, displacementError});
+        TimeStepLimit cause = error == displacementError ? TimeStepLimit::Displacement :
+            error == energyError ? TimeStepLimit::EnergyDrift : TimeStepLimit::SolverResidual;
+        if (!std::isfinite(error) || (std::isfinite(energy) && !std::isfinite(newEnergy))) {
+            error = std::numeric_limits<Scalar>::infinity();
+            cause = TimeStepLimit::EnergyDrift;
+        }
+        Scalar factor = error > 0 ? std::min(Scalar(2), std::max(Scalar(0.2), Scalar(0.9)/std::sqrt(error))) : 2;
+        
+        if (error > 1 && step > minTimeStep) {
+            q = q_saved;
+            q_dot = q_dot_saved;
+            accelerationValid = false;
+            timeStepStats.rejected++;
+            nextTimeStep = std::max(minTimeStep, step*factor);
+            nextLimit = nextTimeStep == minTimeStep ? TimeStepLimit::MinStep : cause;
+            continue;
+        }
+        
+        timeStepStats.substeps++;
+        timeStepStats.h = step;
+        timeStepStats.limit = error > 1 ? TimeStepLimit::MinStep : limit;
+        timeStepStats.residualError = residualError;
+        timeStepStats.energyError = energyError;
+        timeStepStats.displacementError = displacementError;
+        energy = newEnergy;
+        kinetic = newKinetic;
+        remaining = count == 1 ? 0 : remaining - step;
+        
+        nextTimeStep = std::min(std::max(step*factor, minTimeStep), maxTimeStep);
+        if (nextTimeStep == maxTimeStep) {
+            nextLimit = TimeStepLimit::MaxStep;
+        } else if (nextTimeStep == minTimeStep) {
+            nextLimit = TimeStepLimit::MinStep;
+        } else {
+            nextLimit = factor == 2 ? TimeStepLimit::Growth : cause;
+        }
+    }
 }
 
 #endif /* physics_h */
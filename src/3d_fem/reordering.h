@@ -0,0 +1,209 @@
+#ifndef reordering_h
+#define reordering_h
+
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <string>
+#include <limits>
+
+/**
+ * Vertex orderings that put vertices of the same tetrahedron close in memory.
+ * Meshes from tetrahedralizers come in arbitrary order, so element loops gather and scatter
+ * all over the coordinate vector and sparse matrices have a wide profile.
+ */
+
+enum class VertexOrdering {
+    // Order of the mesh file.
+    None,
+    // Breadth first search from a peripheral vertex, reversed. Minimizes the bandwidth of the mesh graph.
+    ReverseCuthillMcKee,
+    // Z-order curve over the bounding box.
+    Morton,
+    // Hilbert curve over the bounding box, neighbouring keys are always neighbouring cells.
+    Hilbert
+};
+
+std::string vertexOrderingName(VertexOrdering ordering) {
+    switch (ordering) {
+        case VertexOrdering::ReverseCuthillMcKee: return "rcm";
+        case VertexOrdering::Morton: return "morton";
+        case VertexOrdering::Hilbert: return "hilbert";
+        default: return "none";
+    }
+}
+
+// Bits per coordinate of space-filling curve keys.
+const int curveBits = 21;
+
+// Interleaves bits of 3 coordinates, highest bits first.
+uint64_t interleaveBits(const uint32_t x[3]) {
+    uint64_t key = 0;
+    for (int b = curveBits - 1; b >= 0; b--) {
+        for (int i = 0; i<3; i++) {
+            key = (key << 1) | ((x[i] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+// Hilbert curve key of a grid cell, Skilling's transform of the coordinates followed by interleaving.
+uint64_t hilbertKey(uint32_t x[3]) {
+    uint32_t top = 1u << (curveBits - 1);
+    for (uint32_t Q = top; Q > 1; Q >>= 1) {
+        uint32_t P = Q - 1;
+        for (int i = 0; i<3; i++) {
+            if (x[i] & Q) {
+                x[0] ^= P;
+            } else {
+                uint32_t t = (x[0] ^ x[i]) & P;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+    // Gray encoding.
+    for (int i = 1; i<3; i++) {
+        x[i] ^= x[i - 1];
+    }
+    uint32_t t = 0;
+    for (uint32_t Q = top; Q > 1; Q >>= 1) {
+        if (x[2] & Q) {
+            t ^= Q - 1;
+        }
+    }
+    for (int i = 0; i<3; i++) {
+        x[i] ^= t;
+    }
+    return interleaveBits(x);
+}
+
+// Vertices sorted by keys of a space-filling curve over the bounding box.
+std::vector<int> curveOrder(const std::vector<Eigen::Vector3f> &positions, bool hilbert) {
+    int n = positions.size();
+    Eigen::Vector3f lower = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+    Eigen::Vector3f upper = Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+    for (const auto &p : positions) {
+        lower = lower.cwiseMin(p);
+        upper = upper.cwiseMax(p);
+    }
+    // Same scale on all axes, so cells are cubes.
+    float scale = ((1u << curveBits) - 1)/std::max((upper - lower).maxCoeff(), 1e-12f);
+
+    std::vector<uint64_t> keys(n);
+    for (int v = 0; v<n; v++) {
+        uint32_t x[3];
+        for (int k = 0; k<3; k++) {
+            x[k] = (uint32_t)((positions[v][k] - lower[k])*scale);
+        }
+        keys[v] = hilbert ? hilbertKey(x) : interleaveBits(x);
+    }
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+// Reverse Cuthill-McKee order of the graph of vertices sharing a tetrahedron.
+std::vector<int> reverseCuthillMcKeeOrder(unsigned long n, const std::vector<unsigned int> &tetIndices) {
+    std::vector<std::vector<int>> neighbours(n);
+    for (size_t i = 0; i + 3<tetIndices.size(); i += 4) {
+        for (int j = 0; j<4; j++) {
+            for (int k = 0; k<4; k++) {
+                if (j != k) {
+                    neighbours[tetIndices[i + j]].push_back(tetIndices[i + k]);
+                }
+            }
+        }
+    }
+    for (auto &list : neighbours) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    auto byDegree = [&](int a, int b) {
+        return neighbours[a].size() < neighbours[b].size() || (neighbours[a].size() == neighbours[b].size() && a < b);
+    };
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> level(n, -1);
+    // Breadth first search from start appending to order, returns the lowest degree vertex of the last level.
+    auto search = [&](int start) {
+        size_t begin = order.size();
+        order.push_back(start);
+        level[start] = 0;
+        for (size_t head = begin; head<order.size(); head++) {
+            int v = order[head];
+            size_t added = order.size();
+            for (int u : neighbours[v]) {
+                if (level[u] < 0) {
+                    level[u] = level[v] + 1;
+                    order.push_back(u);
+                }
+            }
+            std::sort(order.begin() + added, order.end(), byDegree);
+        }
+        int last = order.back();
+        for (size_t k = order.size(); k-- > begin && level[order[k]] == level[last];) {
+            if (byDegree(order[k], last)) {
+                last = order[k];
+            }
+        }
+        return last;
+    };
+
+    std::vector<int> vertices(n);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::sort(vertices.begin(), vertices.end(), byDegree);
+    for (int start : vertices) {
+        if (level[start] >= 0) {
+            continue;
+        }
+        // A few searches move the start to a pseudo-peripheral vertex of the component.
+        size_t begin = order.size();
+        auto reset = [&]() {
+            for (size_t k = begin; k<order.size(); k++) {
+                level[order[k]] = -1;
+            }
+            order.resize(begin);
+        };
+        int last = search(start);
+        int depth = level[order.back()];
+        for (int attempt = 0; attempt<3; attempt++) {
+            reset();
+            int next = search(last);
+            int nextDepth = level[order.back()];
+            if (nextDepth <= depth) {
+                break;
+            }
+            last = next;
+            depth = nextDepth;
+        }
+        reset();
+        search(last);
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Returns the new order of vertices, order[k] is the mesh index of k-th vertex.
+std::vector<int> orderVertices(VertexOrdering ordering, const std::vector<Eigen::Vector3f> &positions,
+                               const std::vector<unsigned int> &tetIndices) {
+    switch (ordering) {
+        case VertexOrdering::ReverseCuthillMcKee:
+            return reverseCuthillMcKeeOrder(positions.size(), tetIndices);
+        case VertexOrdering::Morton:
+            return curveOrder(positions, false);
+        case VertexOrdering::Hilbert:
+            return curveOrder(positions, true);
+        default: {
+            std::vector<int> order(positions.size());
+            std::iota(order.begin(), order.end(), 0);
+            return order;
+        }
+    }
+}
+
+#endif /* reordering_h */
@@ -0,0 +1,181 @@
+#ifndef sdf_h
+#define sdf_h
+
+#include "../utils/draw_shapes.h"
+#include <Eigen/Dense>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "geometry.h"
+
+/**
+ * Signed distance field of a static closed triangle mesh sampled on a uniform grid, negative inside.
+ * Building it tests every node against every triangle, so grids are cached in a binary file keyed by
+ * the mesh and the grid resolution. Queries are trilinear lookups and don't touch the mesh.
+ */
+class SignedDistanceField {
+
+private:
+    Eigen::Vector3f lower = Eigen::Vector3f::Zero();
+    float cellSize = 1;
+    // Nodes per axis, node (x, y, z) is values[(z*dims[1] + y)*dims[0] + x].
+    Eigen::Vector3i dims = Eigen::Vector3i::Constant(2);
+    std::vector<float> values;
+
+    // Identifies the mesh and the resolution a cache file was built for (FNV-1a over their bytes).
+    static uint64_t checksum(const Mesh &mesh, float cellSize, int padding) {
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&](const void *data, size_t size) {
+            const unsigned char *bytes = (const unsigned char *)data;
+            for (size_t k = 0; k<size; k++) {
+                hash = (hash ^ bytes[k])*1099511628211ull;
+            }
+        };
+        for (const auto &p : mesh.positions) {
+            add(p.data(), 3*sizeof(float));
+        }
+        add(mesh.indices.data(), mesh.indices.size()*sizeof(unsigned int));
+        add(&cellSize, sizeof(cellSize));
+        add(&padding, sizeof(padding));
+        return hash;
+    }
+
+    bool load(const std::string &path, uint64_t key) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[4];
+        uint64_t fileKey = 0;
+        if (!file.read(magic, 4) || std::memcmp(magic, "SDF1", 4) != 0 ||
+            !file.read((char *)&fileKey, sizeof(fileKey)) || fileKey != key) {
+            return false;
+        }
+        file.read((char *)dims.data(), 3*sizeof(int));
+        file.read((char *)lower.data(), 3*sizeof(float));
+        file.read((char *)&cellSize, sizeof(cellSize));
+        if (!file || dims.minCoeff() < 2) {
+            return false;
+        }
+        values.resize((long)dims.prod());
+        return (bool)file.read((char *)values.data(), values.size()*sizeof(float));
+    }
+
+    void save(const std::string &path, uint64_t key) const {
+        std::ofstream file(path, std::ios::binary);
+        file.write("SDF1", 4);
+        file.write((const char *)&key, sizeof(key));
+        file.write((const char *)dims.data(), 3*sizeof(int));
+        file.write((const char *)lower.data(), 3*sizeof(float));
+        file.write((const char *)&cellSize, sizeof(cellSize));
+        file.write((const char *)values.data(), values.size()*sizeof(float));
+        if (!file) {
+            std::cout << "Failed to write distance field cache " << path << std::endl;
+        }
+    }
+
+    // Distances of all nodes to the closest triangle, inside where the winding number of the mesh is over 1/2.
+    void compute(const Mesh &mesh, int padding) {
+        Eigen::Vector3f upper = Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+        lower = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+        for (const auto &p : mesh.positions) {
+            lower = lower.cwiseMin(p);
+            upper = upper.cwiseMax(p);
+        }
+        if (mesh.positions.empty()) {
+            lower.setZero();
+            upper.setZero();
+        }
+        lower -= Eigen::Vector3f::Constant(padding*cellSize);
+        for (int k = 0; k<3; k++) {
+            dims[k] = std::max(2, (int)std::ceil((upper[k] - lower[k])/cellSize) + padding + 1);
+        }
+
+        long nodes = (long)dims.prod();
+        int n_faces = mesh.indices.size()/3;
+        values.resize(nodes);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (long node = 0; node<nodes; node++) {
+            Eigen::Vector3f p = lower + cellSize*Eigen::Vector3f(node%dims[0], node/dims[0]%dims[1], node/dims[0]/dims[1]);
+            float best = std::numeric_limits<float>::max();
+            float angle = 0;
+            for (int f = 0; f<n_faces; f++) {
+                const Eigen::Vector3f &a = mesh.positions[mesh.indices[3*f]];
+                const Eigen::Vector3f &b = mesh.positions[mesh.indices[3*f + 1]];
+                const Eigen::Vector3f &c = mesh.positions[mesh.indices[3*f + 2]];
+                best = std::min(best, (p - closestPointOnTriangle(p, a, b, c)).squaredNorm());
+                angle += solidAngle(p, a, b, c);
+            }
+            float distance = std::sqrt(best);
+            values[node] = angle > 2*M_PI ? -distance : distance;
+        }
+    }
+
+public:
+    SignedDistanceField() = default;
+
+    // Field of a closed outward facing mesh on a grid with cells of cellSize, padded by padding cells around it.
+    // With a cachePath the grid is read from it if it was built for the same mesh and resolution, otherwise
+    // it is computed and written there.
+    SignedDistanceField(const Mesh &mesh, float cellSize, const std::string &cachePath = "", int padding = 2):
+        cellSize(cellSize) {
+        uint64_t key = checksum(mesh, cellSize, padding);
+        if (!cachePath.empty() && load(cachePath, key)) {
+            return;
+        }
+        compute(mesh, padding);
+        if (!cachePath.empty()) {
+            save(cachePath, key);
+        }
+    }
+
+    // Signed distance to the surface at p and the outward normal there (normalized gradient of the field).
+    // Points outside the grid add their distance to the grid box.
+    float distance(const Eigen::Vector3f &p, Eigen::Vector3f &normal) const {
+        // Diverged points are outside everything rather than indices out of the grid.
+        if (!p.allFinite()) {
+            normal = Eigen::Vector3f::UnitY();
+            return std::numeric_limits<float>::max();
+        }
+        Eigen::Vector3f upper = lower + cellSize*(dims.array() - 1).matrix().cast<float>();
+        Eigen::Vector3f inside = p.cwiseMax(lower).cwiseMin(upper);
+        Eigen::Vector3f x = (inside - lower)/cellSize;
+        Eigen::Vector3i cell;
+        Eigen::Vector3f t;
+        for (int k = 0; k<3; k++) {
+            cell[k] = std::min((int)x[k], dims[k] - 2);
+            t[k] = x[k] - cell[k];
+        }
+
+        // Trilinear interpolation of the 8 corners and its derivatives along the axes.
+        float value = 0;
+        Eigen::Vector3f gradient = Eigen::Vector3f::Zero();
+        for (int corner = 0; corner<8; corner++) {
+            Eigen::Vector3i offset(corner & 1, (corner >> 1) & 1, corner >> 2);
+            Eigen::Vector3i node = cell + offset;
+            float c = values[(node[2]*dims[1] + node[1])*dims[0] + node[0]];
+            Eigen::Vector3f w;
+            for (int k = 0; k<3; k++) {
+                w[k] = offset[k] ? t[k] : 1 - t[k];
+            }
+            value += w.prod()*c;
+            gradient[0] += (offset[0] ? 1 : -1)*w[1]*w[2]*c;
+            gradient[1] += (offset[1] ? 1 : -1)*w[0]*w[2]*c;
+            gradient[2] += (offset[2] ? 1 : -1)*w[0]*w[1]*c;
+        }
+
+        Eigen::Vector3f outside = p - inside;
+        float outsideDistance = outside.norm();
+        if (outsideDistance > 0) {
+            normal = outside/outsideDistance;
+            return value + outsideDistance;
+        }
+        float length = gradient.norm();
+        normal = length > 0 ? Eigen::Vector3f(gradient/length) : Eigen::Vector3f::UnitY();
+        return value;
+    }
+};
+
+#endif /* sdf_h */
@@ -0,0 +1,336 @@
+#ifndef self_collision_h
+#define self_collision_h
+
+#include <Eigen/Dense>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "types.h"
+#include "geometry.h"
+
+// Surface vertex touching a boundary triangle. The gap is normal.dot(sum of weights[j]*x_j) - thickness,
+// vertices[0] is the vertex with weight 1 and the triangle vertices are weighted by minus barycentric
+// coordinates of the closest point, so the gap is linear in positions.
+template<typename Scalar>
+struct SurfaceContact {
+    TetIndices vertices;
+    Eigen::Matrix<Scalar, 4, 1> weights;
+    Eigen::Matrix<Scalar, 3, 1> normal;
+};
+
+/**
+ * Vertex-triangle self-collision detection on the boundary surface of a tetrahedral mesh.
+ * Broad phase is a spatial hash over triangle bounding boxes refilled every step with atomic counters
+ * into preallocated flat buckets, narrow phase finds the closest triangle of every surface vertex in parallel.
+ * Order of triangles within a bucket depends on threads, ties of the narrow phase go to the lowest triangle,
+ * so contacts don't.
+ */
+template<typename Scalar>
+class SelfCollision {
+
+private:
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    // Boundary triangles, 3 vertices each, counterclockwise seen from outside.
+    std::vector<int> triangles;
+    std::vector<int> surfaceVertices;
+    // One-ring of k-th surface vertex, itself included, sorted as ringVertices[ringOffsets[k]..ringOffsets[k + 1]).
+    // Triangles with a vertex in it touch the triangles around the vertex and are never its contacts.
+    std::vector<int> ringOffsets;
+    std::vector<int> ringVertices;
+    // Mean length of boundary edges at rest, the smallest cell of the hash.
+    Scalar meanEdge = 1;
+    Scalar cellSize = 1;
+    // Bucket b lists triangles overlapping cells hashed to it as bucketTriangles[bucketOffsets[b]..bucketOffsets[b + 1]).
+    std::vector<int> bucketOffsets;
+    std::vector<int> bucketFill;
+    std::vector<int> bucketTriangles;
+    // Narrow phase result per surface vertex, -1 without contact.
+    std::vector<int> closestTriangles;
+    std::vector<Vector3, Eigen::aligned_allocator<Vector3>> closestWeights;
+    std::vector<int> vertexContactFill;
+
+    unsigned int bucket(const Eigen::Vector3i &cell) const {
+        unsigned int hash = ((unsigned int)cell[0]*73856093u) ^ ((unsigned int)cell[1]*19349663u) ^ ((unsigned int)cell[2]*83492791u);
+        return hash & (unsigned int)(bucketFill.size() - 1);
+    }
+
+    Eigen::Vector3i cellOf(const Vector3 &p) const {
+        return (p/cellSize).array().floor().template cast<int>();
+    }
+
+    Vector3 vertex(const VectorX &qq, int v) const {
+        return qq.template segment<3>(3*v);
+    }
+
+    bool inRing(int k, int v) const {
+        return std::binary_search(ringVertices.begin() + ringOffsets[k], ringVertices.begin() + ringOffsets[k + 1], v);
+    }
+
+    // Cells overlapped by f-th triangle inflated by radius.
+    void cellRange(const VectorX &qq, int f, Scalar radius, Eigen::Vector3i &from, Eigen::Vector3i &to) const {
+        Vector3 boxLower = vertex(qq, triangles[3*f]);
+        Vector3 boxUpper = boxLower;
+        for (int k = 1; k<3; k++) {
+            boxLower = boxLower.cwiseMin(vertex(qq, triangles[3*f + k]));
+            boxUpper = boxUpper.cwiseMax(vertex(qq, triangles[3*f + k]));
+        }
+        from = cellOf(boxLower - Vector3::Constant(radius));
+        to = cellOf(boxUpper + Vector3::Constant(radius));
+    }
+
+public:
+    // Contacts found by the last detect call and, for every vertex v, the contacts it takes part in as
+    // vertexContacts[vertexContactOffsets[v]..vertexContactOffsets[v + 1]), stored as 4*contact + its slot.
+    AlignedVector<SurfaceContact<Scalar>> contacts;
+    std::vector<int> vertexContactOffsets;
+    std::vector<int> vertexContacts;
+
+    SelfCollision() = default;
+
+    // Boundary of tetrahedra with n vertices at rest positions qq: faces that belong to a single tetrahedron.
+    template<typename Element>
+    SelfCollision(const AlignedVector<Element> &elements, int n, const VectorX &qq) {
+        static const int faces[4][3] = {{1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
+        std::vector<std::array<int, 5>> keyedFaces;
+        keyedFaces.reserve(4*elements.size());
+        for (int i = 0; i<elements.size(); i++) {
+            for (int k = 0; k<4; k++) {
+                std::array<int, 3> face = {elements[i].indices[faces[k][0]], elements[i].indices[faces[k][1]], elements[i].indices[faces[k][2]]};
+                std::sort(face.begin(), face.end());
+                keyedFaces.push_back({face[0], face[1], face[2], i, k});
+            }
+        }
+        std::sort(keyedFaces.begin(), keyedFaces.end());
+        Scalar edgeSum = 0;
+        for (size_t j = 0; j<keyedFaces.size(); j++) {
+            bool shared = (j > 0 && std::equal(keyedFaces[j].begin(), keyedFaces[j].begin() + 3, keyedFaces[j - 1].begin())) ||
+                          (j + 1<keyedFaces.size() && std::equal(keyedFaces[j].begin(), keyedFaces[j].begin() + 3, keyedFaces[j + 1].begin()));
+            if (shared) {
+                continue;
+            }
+            const TetIndices &indices = elements[keyedFaces[j][3]].indices;
+            int k = keyedFaces[j][4];
+            int a = indices[faces[k][0]];
+            int b = indices[faces[k][1]];
+            int c = indices[faces[k][2]];
+            // Normal points away from the opposite vertex of the tetrahedron.
+            if ((vertex(qq, b) - vertex(qq, a)).cross(vertex(qq, c) - vertex(qq, a)).dot(vertex(qq, indices[k]) - vertex(qq, a)) > 0) {
+                std::swap(b, c);
+            }
+            triangles.insert(triangles.end(), {a, b, c});
+            edgeSum += (vertex(qq, b) - vertex(qq, a)).norm() + (vertex(qq, c) - vertex(qq, b)).norm() + (vertex(qq, a) - vertex(qq, c)).norm();
+        }
+        int n_triangles = triangles.size()/3;
+        meanEdge = n_triangles > 0 ? edgeSum/(3*n_triangles) : 1;
+
+        std::vector<bool> onSurface(n, false);
+        for (int v : triangles) {
+            onSurface[v] = true;
+        }
+        std::vector<int> surfaceIndex(n, -1);
+        for (int v = 0; v<n; v++) {
+            if (onSurface[v]) {
+                surfaceIndex[v] = surfaceVertices.size();
+                surfaceVertices.push_back(v);
+            }
+        }
+        std::vector<std::vector<int>> rings(surfaceVertices.size());
+        for (int f = 0; f<n_triangles; f++) {
+            for (int j = 0; j<3; j++) {
+                std::vector<int> &ring = rings[surfaceIndex[triangles[3*f + j]]];
+                ring.insert(ring.end(), {triangles[3*f], triangles[3*f + 1], triangles[3*f + 2]});
+            }
+        }
+        ringOffsets.assign(1, 0);
+        for (std::vector<int> &ring : rings) {
+            std::sort(ring.begin(), ring.end());
+            ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+            ringVertices.insert(ringVertices.end(), ring.begin(), ring.end());
+            ringOffsets.push_back(ringVertices.size());
+        }
+
+        // Power of two buckets, about two per triangle.
+        int buckets = 1;
+        while (buckets < 2*n_triangles) {
+            buckets *= 2;
+        }
+        bucketOffsets.assign(buckets + 1, 0);
+        bucketFill.assign(buckets, 0);
+        // Cells are at least a mean edge and the padding radius wide, so padded boxes of triangles no longer
+        // than a mean edge overlap at most 3x3x3 cells. Longer triangles grow the array once to its high mark.
+        bucketTriangles.reserve(27*n_triangles);
+        closestTriangles.assign(surfaceVertices.size(), -1);
+        closestWeights.assign(surfaceVertices.size(), Vector3::Zero());
+        contacts.reserve(surfaceVertices.size());
+        vertexContactOffsets.assign(n + 1, 0);
+        vertexContactFill.assign(n, 0);
+        vertexContacts.reserve(4*surfaceVertices.size());
+    }
+
+    void clear() {
+        contacts.clear();
+        std::fill(closestTriangles.begin(), closestTriangles.end(), -1);
+        std::fill(vertexContactOffsets.begin(), vertexContactOffsets.end(), 0);
+    }
+
+    Scalar getMeanEdge() const {
+        return meanEdge;
+    }
+
+    int getTriangleCount() const {
+        return triangles.size()/3;
+    }
+
+    // Finds contacts at positions qq of surface vertices outside a triangle away from their one-ring and closer
+    // to it than thickness plus twice the distance they can approach it in time h, from their velocities qq_dot
+    // relative to the triangle vertices, so a body moving as a whole has none. Contacts of the previous call are
+    // kept while their vertices are behind the triangle by less than a mean edge, so they are pushed out again.
+    void detect(const VectorX &qq, const VectorX &qq_dot, Scalar h, Scalar thickness, int n_threads) {
+        int n_surface = surfaceVertices.size();
+        int n_triangles = triangles.size()/3;
+        // Relative speeds of surface vertices are at most twice their largest speed relative to the mean.
+        Vector3 meanVelocity = Vector3::Zero();
+        for (int k = 0; k<n_surface; k++) {
+            meanVelocity += qq_dot.template segment<3>(3*surfaceVertices[k]);
+        }
+        meanVelocity /= std::max(n_surface, 1);
+        Scalar maxDeviation = 0;
+        #pragma omp parallel for num_threads(n_threads) schedule(static) reduction(max:maxDeviation)
+        for (int k = 0; k<n_surface; k++) {
+            maxDeviation = std::max(maxDeviation, (qq_dot.template segment<3>(3*surfaceVertices[k]) - meanVelocity).norm());
+        }
+        Scalar radius = thickness + 4*h*maxDeviation;
+        cellSize = std::max(meanEdge, radius);
+
+        // Counting triangles per bucket, then filling them. Both passes only take atomic increments.
+        std::fill(bucketFill.begin(), bucketFill.end(), 0);
+        #pragma omp parallel for num_threads(n_threads) schedule(static)
+        for (int f = 0; f<n_triangles; f++) {
+            Eigen::Vector3i from, to;
+            cellRange(qq, f, radius, from, to);
+            for (int z = from[2]; z<=to[2]; z++) {
+                for (int y = from[1]; y<=to[1]; y++) {
+                    for (int x = from[0]; x<=to[0]; x++) {
+                        unsigned int b = bucket(Eigen::Vector3i(x, y, z));
+                        #pragma omp atomic
+                        bucketFill[b]++;
+                    }
+                }
+            }
+        }
+        int buckets = bucketFill.size();
+        for (int b = 0; b<buckets; b++) {
+            bucketOffsets[b + 1] = bucketOffsets[b] + bucketFill[b];
+            bucketFill[b] = bucketOffsets[b];
+        }
+        if (bucketTriangles.size() < bucketOffsets[buckets]) {
+            bucketTriangles.resize(bucketOffsets[buckets]);
+        }
+        #pragma omp parallel for num_threads(n_threads) schedule(static)
+        for (int f = 0; f<n_triangles; f++) {
+            Eigen::Vector3i from, to;
+            cellRange(qq, f, radius, from, to);
+            for (int z = from[2]; z<=to[2]; z++) {
+                for (int y = from[1]; y<=to[1]; y++) {
+                    for (int x = from[0]; x<=to[0]; x++) {
+                        unsigned int b = bucket(Eigen::Vector3i(x, y, z));
+                        int slot;
+                        #pragma omp atomic capture
+                        slot = bucketFill[b]++;
+                        bucketTriangles[slot] = f;
+                    }
+                }
+            }
+        }
+
+        // Closest triangle of every surface vertex among triangles hashed to its cell.
+        #pragma omp parallel for num_threads(n_threads) schedule(static)
+        for (int k = 0; k<n_surface; k++) {
+            int v = surfaceVertices[k];
+            Vector3 p = vertex(qq, v);
+            // A vertex pushed behind its triangle within a step keeps the contact until it is out again.
+            int previous = closestTriangles[k];
+            if (previous >= 0) {
+                const int *t = &triangles[3*previous];
+                Vector3 closest = closestPointOnTriangle(p, vertex(qq, t[0]), vertex(qq, t[1]), vertex(qq, t[2]));
+                Vector3 normal = (vertex(qq, t[1]) - vertex(qq, t[0])).cross(vertex(qq, t[2]) - vertex(qq, t[0]));
+                if (normal.dot(p - closest) < 0 && (p - closest).norm() < meanEdge) {
+                    closestWeights[k] = triangleBarycentric(closest, vertex(qq, t[0]), vertex(qq, t[1]), vertex(qq, t[2]));
+                    continue;
+                }
+            }
+            Vector3 p_dot = vertex(qq_dot, v);
+            unsigned int b = bucket(cellOf(p));
+            int best = -1;
+            Scalar bestDistance = radius*radius;
+            Vector3 bestClosest;
+            for (int j = bucketOffsets[b]; j<bucketOffsets[b + 1]; j++) {
+                int f = bucketTriangles[j];
+                const int *t = &triangles[3*f];
+                if (inRing(k, t[0]) || inRing(k, t[1]) || inRing(k, t[2])) {
+                    continue;
+                }
+                Vector3 closest = closestPointOnTriangle(p, vertex(qq, t[0]), vertex(qq, t[1]), vertex(qq, t[2]));
+                Scalar distance = (p - closest).squaredNorm();
+                Scalar relativeSpeed = 0;
+                for (int i = 0; i<3; i++) {
+                    relativeSpeed = std::max(relativeSpeed, (p_dot - vertex(qq_dot, t[i])).norm());
+                }
+                Scalar pairRadius = thickness + 2*h*relativeSpeed;
+                // New contacts only start on the outer side, thin parts of the mesh are not contacts.
+                if (distance >= pairRadius*pairRadius) {
+                    continue;
+                }
+                if (distance < bestDistance || (distance == bestDistance && best >= 0 && f < best)) {
+                    Vector3 normal = (vertex(qq, t[1]) - vertex(qq, t[0])).cross(vertex(qq, t[2]) - vertex(qq, t[0]));
+                    if (normal.dot(p - closest) >= 0) {
+                        best = f;
+                        bestDistance = distance;
+                        bestClosest = closest;
+                    }
+                }
+            }
+            closestTriangles[k] = best;
+            if (best >= 0) {
+                const int *t = &triangles[3*best];
+                closestWeights[k] = triangleBarycentric(bestClosest, vertex(qq, t[0]), vertex(qq, t[1]), vertex(qq, t[2]));
+            }
+        }
+
+        // Contacts in order of surface vertices and the contacts around every vertex.
+        contacts.clear();
+        int n = vertexContactOffsets.size() - 1;
+        std::fill(vertexContactOffsets.begin(), vertexContactOffsets.end(), 0);
+        for (int k = 0; k<n_surface; k++) {
+            int f = closestTriangles[k];
+            if (f < 0) {
+                continue;
+            }
+            const int *t = &triangles[3*f];
+            SurfaceContact<Scalar> contact;
+            contact.vertices = {surfaceVertices[k], t[0], t[1], t[2]};
+            contact.weights << 1, -closestWeights[k];
+            contact.normal = (vertex(qq, t[1]) - vertex(qq, t[0])).cross(vertex(qq, t[2]) - vertex(qq, t[0])).normalized();
+            contacts.push_back(contact);
+            for (int j = 0; j<4; j++) {
+                vertexContactOffsets[contact.vertices[j] + 1]++;
+            }
+        }
+        for (int v = 0; v<n; v++) {
+            vertexContactOffsets[v + 1] += vertexContactOffsets[v];
+        }
+        vertexContacts.resize(vertexContactOffsets[n]);
+        std::copy(vertexContactOffsets.begin(), vertexContactOffsets.end() - 1, vertexContactFill.begin());
+        for (int c = 0; c<contacts.size(); c++) {
+            for (int j = 0; j<4; j++) {
+                vertexContacts[vertexContactFill[contacts[c].vertices[j]]++] = 4*c + j;
+            }
+        }
+    }
+};
+
+#endif /* self_collision_h */
@@ -0,0 +1,209 @@
+#ifndef tet_grid_h
+#define tet_grid_h
+
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "types.h"
+#include "geometry.h"
+
+/**
+ * Uniform grid over bounding boxes of tetrahedra, built once for point location.
+ * Every cell lists tetrahedra whose bounding box overlaps it, stored as one flat array with offsets per cell.
+ * Positions are in Scalar, rest state of the tetrahedra may be stored in a lower precision ElementScalar.
+ */
+
+template<typename Scalar, typename ElementScalar = Scalar>
+class TetGrid {
+
+private:
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::Matrix<Scalar, 4, 1> Vector4;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    Vector3 lower;
+    Scalar cellSize = 1;
+    Eigen::Vector3i dims = Eigen::Vector3i::Ones();
+    // Tetrahedra overlapping cell c are cellTets[cellOffsets[c]..cellOffsets[c + 1]).
+    std::vector<int> cellOffsets;
+    std::vector<int> cellTets;
+
+    const AlignedVector<TetElement<ElementScalar>> *elements = nullptr;
+    const VectorX *positions = nullptr;
+
+    Vector3 vertex(int i, int k) const {
+        return positions->template segment<3>(3*(*elements)[i].indices[k]);
+    }
+
+    // Bounding box of i-th tetrahedron.
+    void bounds(int i, Vector3 &boxLower, Vector3 &boxUpper) const {
+        boxLower = vertex(i, 0);
+        boxUpper = vertex(i, 0);
+        for (int k = 1; k<4; k++) {
+            boxLower = boxLower.cwiseMin(vertex(i, k));
+            boxUpper = boxUpper.cwiseMax(vertex(i, k));
+        }
+    }
+
+    Eigen::Vector3i cellOf(const Vector3 &p) const {
+        Eigen::Vector3i cell;
+        for (int k = 0; k<3; k++) {
+            Scalar x = std::floor((p[k] - lower[k])/cellSize);
+            cell[k] = (int)std::min(std::max(x, (Scalar)0), (Scalar)(dims[k] - 1));
+        }
+        return cell;
+    }
+
+    int cellIndex(const Eigen::Vector3i &cell) const {
+        return (cell[2]*dims[1] + cell[1])*dims[0] + cell[0];
+    }
+
+    // Squared distance from p to the bounding box of i-th tetrahedron, a cheap lower bound of the distance to it.
+    Scalar squaredBoxDistance(int i, const Vector3 &p) const {
+        Vector3 boxLower, boxUpper;
+        bounds(i, boxLower, boxUpper);
+        return (p - p.cwiseMax(boxLower).cwiseMin(boxUpper)).squaredNorm();
+    }
+
+    // Squared distance from p to i-th tetrahedron, 0 inside.
+    Scalar squaredDistance(int i, const Vector3 &p) const {
+        if (barycentric(i, p).minCoeff() >= 0) {
+            return 0;
+        }
+        static const int faces[4][3] = {{1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
+        Scalar best = std::numeric_limits<Scalar>::max();
+        for (const auto &face : faces) {
+            Vector3 closest = closestPointOnTriangle(p, vertex(i, face[0]), vertex(i, face[1]), vertex(i, face[2]));
+            best = std::min(best, (p - closest).squaredNorm());
+        }
+        return best;
+    }
+
+public:
+    TetGrid() = default;
+
+    // Grid over tetrahedra with vertex coordinates qq, both have to outlive the grid.
+    TetGrid(const AlignedVector<TetElement<ElementScalar>> &elements, const VectorX &qq): elements(&elements), positions(&qq) {
+        long n_tet = elements.size();
+        lower = Vector3::Constant(std::numeric_limits<Scalar>::max());
+        Vector3 upper = Vector3::Constant(std::numeric_limits<Scalar>::lowest());
+        Scalar meanExtent = 0;
+        for (int i = 0; i<n_tet; i++) {
+            Vector3 boxLower, boxUpper;
+            bounds(i, boxLower, boxUpper);
+            lower = lower.cwiseMin(boxLower);
+            upper = upper.cwiseMax(boxUpper);
+            meanExtent += (boxUpper - boxLower).maxCoeff()/n_tet;
+        }
+        if (n_tet == 0) {
+            lower.setZero();
+            cellOffsets.assign(2, 0);
+            return;
+        }
+        // Cells about the size of a tetrahedron, at most a few cells per tetrahedron.
+        Vector3 extent = (upper - lower).cwiseMax(1e-6f);
+        cellSize = std::max(meanExtent, std::cbrt(extent.prod()/(4.0f*n_tet)));
+        for (int k = 0; k<3; k++) {
+            dims[k] = std::max(1, (int)std::ceil(extent[k]/cellSize));
+        }
+
+        // Counting tetrahedra per cell, then filling the flat array.
+        long cells = (long)dims.prod();
+        cellOffsets.assign(cells + 1, 0);
+        for (int pass = 0; pass<2; pass++) {
+            std::vector<int> fill(cellOffsets.begin(), cellOffsets.end() - 1);
+            for (int i = 0; i<n_tet; i++) {
+                Vector3 boxLower, boxUpper;
+                bounds(i, boxLower, boxUpper);
+                Eigen::Vector3i from = cellOf(boxLower);
+                Eigen::Vector3i to = cellOf(boxUpper);
+                for (int z = from[2]; z<=to[2]; z++) {
+                    for (int y = from[1]; y<=to[1]; y++) {
+                        for (int x = from[0]; x<=to[0]; x++) {
+                            int c = cellIndex(Eigen::Vector3i(x, y, z));
+                            if (pass == 0) {
+                                cellOffsets[c + 1]++;
+                            } else {
+                                cellTets[fill[c]++] = i;
+                            }
+                        }
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (long c = 0; c<cells; c++) {
+                    cellOffsets[c + 1] += cellOffsets[c];
+                }
+                cellTets.resize(cellOffsets[cells]);
+            }
+        }
+    }
+
+    // Barycentric coordinates of p with respect to i-th tetrahedron, all non-negative inside it.
+    Vector4 barycentric(int i, const Vector3 &p) const {
+        const TetElement<ElementScalar> &element = (*elements)[i];
+        Vector3 phi = element.D.template bottomRows<3>().template cast<Scalar>()*(p - vertex(i, 0));
+        return Vector4(1 - phi.sum(), phi[0], phi[1], phi[2]);
+    }
+
+    // Tetrahedron containing p, points on shared faces go to the lowest index (cells list tetrahedra in order).
+    // Points outside the mesh go to the closest tetrahedron, -1 only for an empty mesh.
+    int locate(const Vector3 &p) const {
+        Eigen::Vector3i center = cellOf(p);
+        int c = cellIndex(center);
+        for (int k = cellOffsets[c]; k<cellOffsets[c + 1]; k++) {
+            if (barycentric(cellTets[k], p).minCoeff() >= 0) {
+                return cellTets[k];
+            }
+        }
+
+        // Searching rings of cells around p until they are farther than the closest tetrahedron found.
+        // Points outside the grid are at least as far from a cell as from the grid box, plus the ring offset.
+        Vector3 upper = lower + cellSize*dims.template cast<Scalar>();
+        Scalar outside = (p - p.cwiseMax(lower).cwiseMin(upper)).squaredNorm();
+        int best = -1;
+        Scalar bestDistance = std::numeric_limits<Scalar>::max();
+        int maxRing = dims.maxCoeff();
+        for (int ring = 0; ring<=maxRing; ring++) {
+            Scalar ringDistance = std::max(0, ring - 1)*cellSize;
+            if (best >= 0 && outside + ringDistance*ringDistance > bestDistance) {
+                break;
+            }
+            Eigen::Vector3i from = (center.array() - ring).max(0);
+            Eigen::Vector3i to = (center.array() + ring).min(dims.array() - 1);
+            for (int z = from[2]; z<=to[2]; z++) {
+                for (int y = from[1]; y<=to[1]; y++) {
+                    for (int x = from[0]; x<=to[0]; x++) {
+                        Eigen::Vector3i cell(x, y, z);
+                        if ((cell - center).cwiseAbs().maxCoeff() != ring) {
+                            continue;
+                        }
+                        // Cells farther than the closest tetrahedron found can't hold a closer one.
+                        Vector3 cellLower = lower + cellSize*cell.template cast<Scalar>();
+                        Vector3 cellUpper = cellLower + Vector3::Constant(cellSize);
+                        if ((p - p.cwiseMax(cellLower).cwiseMin(cellUpper)).squaredNorm() > bestDistance) {
+                            continue;
+                        }
+                        int c = cellIndex(cell);
+                        for (int k = cellOffsets[c]; k<cellOffsets[c + 1]; k++) {
+                            int i = cellTets[k];
+                            if (squaredBoxDistance(i, p) > bestDistance) {
+                                continue;
+                            }
+                            Scalar distance = squaredDistance(i, p);
+                            if (distance < bestDistance || (distance == bestDistance && i < best)) {
+                                best = i;
+                                bestDistance = distance;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return best;
+    }
+};
+
+#endif /* tet_grid_h */
@@ -0,0 +1,70 @@
+#ifndef types_h
+#define types_h
+
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <vector>
+#include <array>
+
+/**
+ * Fixed size types of per-tetrahedron quantities. They live on the stack, so element kernels don't touch the heap.
+ * All of them are templates on the scalar type, the f suffixed names are the single precision ones.
+ */
+
+// Flattened deformation gradient.
+template<typename Scalar> using Vector9 = Eigen::Matrix<Scalar, 9, 1>;
+// Coordinates of 4 vertices of a tetrahedron.
+template<typename Scalar> using Vector12 = Eigen::Matrix<Scalar, 12, 1>;
+// Hessian of the strain energy density.
+template<typename Scalar> using Matrix9 = Eigen::Matrix<Scalar, 9, 9>;
+// Stiffness matrix of a tetrahedron.
+template<typename Scalar> using Matrix12 = Eigen::Matrix<Scalar, 12, 12>;
+// Maps tetrahedron coordinates to the flattened deformation gradient.
+template<typename Scalar> using Matrix9x12 = Eigen::Matrix<Scalar, 9, 12>;
+template<typename Scalar> using Matrix4x3 = Eigen::Matrix<Scalar, 4, 3>;
+template<typename Scalar> using Matrix3x4 = Eigen::Matrix<Scalar, 3, 4>;
+
+typedef Vector9<float> Vector9f;
+typedef Vector12<float> Vector12f;
+typedef Matrix9<float> Matrix9f;
+typedef Matrix12<float> Matrix12f;
+typedef Matrix9x12<float> Matrix9x12f;
+typedef Matrix4x3<float> Matrix4x3f;
+typedef Matrix3x4<float> Matrix3x4f;
+
+// Fixed size vectorizable Eigen types need an aligned allocator in std containers.
+template<typename Type>
+using AlignedVector = std::vector<Type, Eigen::aligned_allocator<Type>>;
+
+// Vertex indices of a tetrahedron.
+typedef std::array<int, 4> TetIndices;
+
+// Topology and rest state of a tetrahedron, packed into one record so element loops read a single
+// contiguous entry per tetrahedron. Rest state is stored in the precision of element kernels.
+template<typename Scalar>
+struct TetElement {
+    // Maps vertex positions to the deformation gradient, F = [x0 x1 x2 x3]*D.
+    // Rows 1 to 3 are the inverse of the rest shape matrix, row 0 is minus their sum.
+    Matrix4x3<Scalar> D;
+    TetIndices indices;
+    Scalar volume;
+    
+    // 3 columns of B acting on coordinates of k-th vertex, B maps coordinates to the flattened deformation gradient.
+    Eigen::Matrix<Scalar, 9, 3> B(int k) const {
+        Eigen::Matrix<Scalar, 9, 3> B_k = Eigen::Matrix<Scalar, 9, 3>::Zero();
+        for (int r = 0; r<3; r++) {
+            B_k.template block<3,1>(3*r, r) = D.row(k).transpose();
+        }
+        return B_k;
+    }
+    
+    Matrix9x12<Scalar> B() const {
+        Matrix9x12<Scalar> B_i;
+        for (int k = 0; k<4; k++) {
+            B_i.template block<9,3>(0, 3*k) = B(k);
+        }
+        return B_i;
+    }
+};
+
+#endif /* types_h */
@@ -0,0 +1,403 @@
+//
+//  main.cpp
+//  fem_benchmark
+//
+//  Benchmarks of FEM simulation kernels. Runs without a window.
+//
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../utils/RootDir.h"
+#include "../3d_fem/physics.h"
+#include "../utils/vertex_normals.h"
+
+#include <Eigen/Dense>
+
+using namespace std;
+
+// Average wall time of one call of f in seconds.
+template<typename Function>
+double measure(Function f, int repeats) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i<repeats; i++) {
+        f();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count()/repeats;
+}
+
+// Largest relative difference of the fused neo-hookean kernel from the generated reference functions of
+// gradient.h and hessian.h over random deformation gradients, near-inverted and inverted ones included.
+double compareNeoHookean(int samples) {
+    typedef Eigen::Matrix<double, 9, 1> Vector9d;
+    typedef Eigen::Matrix<double, 9, 9> Matrix9d;
+    const double C = 170, D = 169.5;
+    srand(1);
+    double maxError = 0;
+    auto relative = [](double difference, double reference) { return difference/std::max(1.0, reference); };
+    for (int s = 0; s<samples; s++) {
+        Eigen::Matrix3d F;
+        if (s%2 == 0) {
+            F = Eigen::Matrix3d::Identity() + 0.5*Eigen::Matrix3d::Random();
+        } else {
+            // Rotations around a singular value close to zero, with either sign.
+            Eigen::Matrix3d U = Eigen::HouseholderQR<Eigen::Matrix3d>(Eigen::Matrix3d::Random()).householderQ();
+            Eigen::Matrix3d V = Eigen::HouseholderQR<Eigen::Matrix3d>(Eigen::Matrix3d::Random()).householderQ();
+            double smallest[] = {1e-3, 1e-2, -1e-3, -0.1};
+            Eigen::Vector3d sigma = Eigen::Vector3d::Ones() + 0.3*Eigen::Vector3d::Random();
+            sigma[2] = smallest[(s/2)%4];
+            F = U*sigma.asDiagonal()*V.transpose();
+        }
+        // Flattened row by row, f = (F00, F01, F02, F10, ..., F22).
+        Eigen::Matrix<double, 3, 3, Eigen::RowMajor> rows = F;
+        Vector9d f = Eigen::Map<const Vector9d>(rows.data());
+        double energy;
+        Vector9d grad;
+        Matrix9d hess;
+        neoHookean<double>(C, D, f, &energy, &grad, &hess);
+        Vector9d referenceGrad = gradPsi(C, D, f);
+        Matrix9d referenceHess = psi_hessian(C, D, f);
+        maxError = std::max(maxError, relative((grad - referenceGrad).norm(), referenceGrad.norm()));
+        maxError = std::max(maxError, relative((hess - referenceHess).norm(), referenceHess.norm()));
+        // The energy has log(J), it is compared where J is positive.
+        if (F.determinant() > 0) {
+            double referenceEnergy = psi(C, D, f);
+            maxError = std::max(maxError, relative(std::abs(energy - referenceEnergy), std::abs(referenceEnergy)));
+        }
+    }
+    return maxError;
+}
+
+// Batched forces at the deformed pose rest + deformation and implicit steps of the bunny falling on obstacle
+// in one precision mode. Positions after the steps are returned in double for comparison between modes.
+template<typename Simulation>
+Eigen::VectorXd benchmarkPrecision(const string &name, TetrahedralMesh &tetMesh, Mesh &skinMesh,
+                                   const Eigen::VectorXf &deformation, const SignedDistanceField &obstacle,
+                                   const Eigen::VectorXd *reference, int repeats) {
+    Simulation pm(tetMesh, skinMesh);
+    typename Simulation::VectorX q = pm.getPositions() + deformation.cast<typename Simulation::VectorX::Scalar>();
+    double forceTime = measure([&]() { pm.dVdQ(q); }, repeats);
+    pm.setIntegrator(Integrator::Newton);
+    pm.setTimeStep(1.0f/60);
+    pm.addObstacle(obstacle);
+    double stepTime = measure([&]() { pm.simulationStep(); }, std::max(1, repeats/10));
+    Eigen::VectorXd positions = pm.getPositions().template cast<double>();
+    cout << "Precision " << name << ": dVdQ " << pm.getTetCount()/forceTime << " tets/s, Newton step "
+         << 1000*stepTime << " ms";
+    if (!positions.allFinite()) {
+        cout << ", NaN positions";
+    } else if (reference) {
+        cout << ", deviation from double " << (positions - *reference).norm()/reference->norm();
+    }
+    cout << endl;
+    return positions;
+}
+
+// Bandwidth and profile of a sparse pattern, the orderings' own measures of locality. The profile is the number
+// of entries between each row's first nonzero and the diagonal, the fill bound of an envelope factorization. The
+// direct solver reorders with AMD before factorizing, so its fill hardly depends on the vertex ordering.
+template<typename SparseMatrix>
+void patternEnvelope(const SparseMatrix &A, long &bandwidth, long &profile) {
+    std::vector<long> first(A.rows());
+    for (long k = 0; k<A.rows(); k++) {
+        first[k] = k;
+    }
+    for (long j = 0; j<A.outerSize(); j++) {
+        for (typename SparseMatrix::InnerIterator it(A, j); it; ++it) {
+            long high = std::max<long>(it.row(), it.col());
+            first[high] = std::min<long>(first[high], std::min<long>(it.row(), it.col()));
+        }
+    }
+    bandwidth = 0;
+    profile = 0;
+    for (long k = 0; k<A.rows(); k++) {
+        bandwidth = std::max(bandwidth, k - first[k]);
+        profile += k - first[k];
+    }
+}
+
+// Per-tetrahedron and batched forces and stiffness matrix at the deformed pose, and implicit steps of the bunny
+// resting on obstacle with one constitutive model. Returns the relative error of batched forces, 0 for models
+// without a SIMD kernel.
+template<typename Simulation>
+float benchmarkMaterial(const string &name, TetrahedralMesh &tetMesh, Mesh &skinMesh, const Eigen::VectorXf &deformation,
+                        const SignedDistanceField &obstacle, int repeats) {
+    Simulation pm(tetMesh, skinMesh);
+    Eigen::VectorXf q = pm.getPositions() + deformation;
+    pm.setBatchedForces(false);
+    Eigen::VectorXf reference = pm.dVdQ(q);
+    double forceTime = measure([&]() { pm.dVdQ(q); }, repeats);
+    pm.setBatchedForces(true);
+    float error = (pm.dVdQ(q) - reference).norm()/reference.norm();
+    double batchedTime = measure([&]() { pm.dVdQ(q); }, repeats);
+    double stiffnessTime = measure([&]() { pm.ddVddQ(q); }, std::max(1, repeats/10));
+    pm.setIntegrator(Integrator::Newton);
+    pm.setTimeStep(1.0f/60);
+    pm.addObstacle(obstacle);
+    // The bunny lands on the cube within a second, the timed steps are all in contact.
+    for (int i = 0; i<60; i++) {
+        pm.simulationStep();
+    }
+    int steps = std::max(1, repeats/10);
+    int iterations = 0;
+    double stepTime = measure([&]() {
+        pm.simulationStep();
+        iterations += pm.getSolverStats().iterations;
+    }, steps);
+    cout << "Material " << name << ": dVdQ " << pm.getTetCount()/forceTime << " tets/s, batched "
+         << pm.getTetCount()/batchedTime << " tets/s, ddVddQ " << 1000*stiffnessTime << " ms, Newton step in contact "
+         << 1000*stepTime << " ms, " << (float)iterations/steps << " iterations" << endl;
+    return error;
+}
+
+int main(int argc, const char * argv[]) {
+    string path_prefix = string(ROOT_DIR) + "src/3d_fem/";
+    int repeats = argc > 1 ? atoi(argv[1]) : 100;
+    
+    TetrahedralMesh tetMesh(path_prefix + "mesh/bunny_tet.msh");
+    Mesh skinMesh(path_prefix + "mesh/bunny.obj");
+    PhysicalMeshf pm(tetMesh, skinMesh);
+    pm.printMemoryReport();
+    
+    // Randomly deformed rest pose.
+    Eigen::VectorXf q = pm.getPositions();
+    srand(0);
+    q += 0.02f*Eigen::VectorXf::Random(q.size());
+    
+    // Generated density derivatives are the reference for the fused kernel.
+    double kernelError = compareNeoHookean(10000);
+    bool kernelConsistent = kernelError < 1e-8;
+    cout << "Fused neo-hookean kernel: relative error " << kernelError << " against gradient.h and hessian.h" << endl;
+    
+    // Per-tetrahedron scalar path is the reference for batched forces.
+    pm.setBatchedForces(false);
+    Eigen::VectorXf reference = pm.dVdQ(q);
+    double scalarTime = measure([&]() { pm.dVdQ(q); }, repeats);
+    cout << "dVdQ per-tetrahedron: " << pm.getTetCount()/scalarTime << " tets/s" << endl;
+    
+    bool consistent = true;
+    pm.setBatchedForces(true);
+    SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (level > detectSimdLevel()) {
+            continue;
+        }
+        pm.setSimdLevel(level);
+        float error = (pm.dVdQ(q) - reference).norm()/reference.norm();
+        consistent = consistent && error < 1e-5f;
+        double time = measure([&]() { pm.dVdQ(q); }, repeats);
+        cout << "dVdQ batched " << simdLevelName(level) << ": " << pm.getTetCount()/time << " tets/s, "
+             << "relative error " << error << endl;
+    }
+    
+    // Skinning into a preallocated buffer against copying the skin mesh every frame.
+    vector<Eigen::Vector3f> skinPositions;
+    pm.updateSkinPositions(skinPositions);
+    double skinTime = measure([&]() { pm.updateSkinPositions(skinPositions); }, repeats);
+    double copyTime = measure([&]() { pm.getSkinMesh(); }, repeats);
+    cout << "Skin update in place: " << skinPositions.size()/skinTime << " vertices/s, with mesh copy: "
+         << skinPositions.size()/copyTime << " vertices/s" << endl;
+    
+    // Area weighted normals of the deformed skin.
+    Mesh skinned = pm.getSkinMesh();
+    VertexNormals normals(skinned);
+    double normalsTime = measure([&]() { normals.update(skinned); }, repeats);
+    cout << "Normals update: " << skinned.indices.size()/3/normalsTime << " faces/s" << endl;
+    
+    // Distance field of the cube under the bunny in the demo, built without a cache, and vertex queries against it.
+    Mesh cubeMesh(path_prefix + "mesh/big_cube.obj");
+    for (auto &v : cubeMesh.positions) {
+        v += Eigen::Vector3f(0, -5.5f, 0);
+    }
+    SignedDistanceField cubeField;
+    double fieldTime = measure([&]() { cubeField = SignedDistanceField(cubeMesh, 0.1f); }, 1);
+    vector<float> distances(skinPositions.size());
+    double queryTime = measure([&]() {
+        #pragma omp parallel for schedule(static)
+        for (int j = 0; j<(int)skinPositions.size(); j++) {
+            Eigen::Vector3f normal;
+            distances[j] = cubeField.distance(skinPositions[j], normal);
+        }
+    }, repeats);
+    cout << "Distance field build: " << 1000*fieldTime << " ms, queries: " << skinPositions.size()/queryTime << " points/s" << endl;
+    
+    // Implicit steps of the bunny falling on the cube, with and without self-collision of its surface.
+    for (bool enabled : {false, true}) {
+        PhysicalMeshf falling(tetMesh, skinMesh);
+        falling.setIntegrator(Integrator::Newton);
+        falling.setTimeStep(1.0f/60);
+        falling.addObstacle(cubeField);
+        falling.setSelfCollision(enabled);
+        double stepTime = measure([&]() { falling.simulationStep(); }, std::max(1, repeats/10));
+        cout << "Newton step with self-collision " << (enabled ? "on" : "off") << ": " << 1000*stepTime << " ms, "
+             << falling.getSelfContactCount() << " contacts" << endl;
+    }
+    
+    // The bunny in free fall only translates, its surface has no self-contacts at any step.
+    int freeFallContacts = 0;
+    {
+        PhysicalMeshf freeFall(tetMesh, skinMesh);
+        freeFall.setIntegrator(Integrator::Newton);
+        freeFall.setTimeStep(1.0f/60);
+        freeFall.setSelfCollision(true);
+        for (int step = 0; step<90; step++) {
+            freeFall.simulationStep();
+            freeFallContacts = std::max(freeFallContacts, freeFall.getSelfContactCount());
+        }
+        cout << "Free fall with self-collision: " << freeFallContacts << " contacts" << endl;
+    }
+    
+    // Frames of 1/60 s of the demo setup with adaptive substeps, and the step the controller settled on.
+    {
+        PhysicalMeshf adaptive(tetMesh, skinMesh, MassMatrix::Lumped);
+        adaptive.setIntegrator(Integrator::VelocityVerlet);
+        adaptive.addObstacle(cubeField);
+        int substeps = 0;
+        int rejected = 0;
+        double frameTime = measure([&]() {
+            adaptive.advance(1.0f/60);
+            substeps += adaptive.getTimeStepStats().substeps;
+            rejected += adaptive.getTimeStepStats().rejected;
+        }, repeats);
+        const TimeStepStats &stats = adaptive.getTimeStepStats();
+        cout << "Adaptive frame: " << 1000*frameTime << " ms, " << (float)substeps/repeats << " substeps, "
+             << (float)rejected/repeats << " rejected, last h " << stats.h << " (" << timeStepLimitName(stats.limit) << ")" << endl;
+    }
+    
+    // Float, double and mixed precision, deviations are relative to the double precision positions.
+    Eigen::VectorXf deformation = q - pm.getPositions();
+    Eigen::VectorXd doublePositions = benchmarkPrecision<PhysicalMeshd>("double", tetMesh, skinMesh, deformation, cubeField, nullptr, repeats);
+    benchmarkPrecision<PhysicalMeshf>("float", tetMesh, skinMesh, deformation, cubeField, &doublePositions, repeats);
+    benchmarkPrecision<PhysicalMeshMixed>("mixed", tetMesh, skinMesh, deformation, cubeField, &doublePositions, repeats);
+    
+    // Constitutive models in single precision, batched forces are checked against the per-tetrahedron ones.
+    float materialError = std::max({
+        benchmarkMaterial<PhysicalMesh<float, float, NeoHookean>>("neo-hookean", tetMesh, skinMesh, deformation, cubeField, repeats),
+        benchmarkMaterial<PhysicalMesh<float, float, StVenantKirchhoff>>("StVK", tetMesh, skinMesh, deformation, cubeField, repeats),
+        benchmarkMaterial<PhysicalMesh<float, float, CorotatedLinear>>("corotated linear", tetMesh, skinMesh, deformation, cubeField, repeats)
+    });
+    consistent = consistent && materialError < 1e-5f;
+    
+    // Reduced order steps of the falling bunny in the span of its lowest modes, with and without modal derivatives.
+    int modeCounts[][2] = {{30, 0}, {100, 0}, {30, 6}};
+    for (auto &counts : modeCounts) {
+        PhysicalMeshf reduced(tetMesh, skinMesh);
+        double modesTime = measure([&]() { reduced.computeModes(counts[0], counts[1]); }, 1);
+        reduced.setIntegrator(Integrator::Modal);
+        reduced.setTimeStep(1.0f/60);
+        reduced.addObstacle(cubeField);
+        int iterations = 0;
+        double stepTime = measure([&]() {
+            reduced.simulationStep();
+            iterations += reduced.getSolverStats().iterations;
+        }, repeats);
+        cout << "Modal " << counts[0] << " modes, " << counts[1] << " with derivatives: basis " << reduced.getModeCount()
+             << " columns in " << 1000*modesTime << " ms, step " << 1000*stepTime << " ms, "
+             << (float)iterations/repeats << " Newton iterations" << endl;
+    }
+    
+    // Nonlinear reduced steps with forces from a cubature trained on the same basis. Training writes a cache file
+    // that a second mesh with the same basis reads back, and a cache with tetrahedra out of range is rejected.
+    bool cubatureCached = true;
+    {
+        string cachePath = "fem_benchmark.cubature";
+        std::remove(cachePath.c_str());
+        PhysicalMeshf reduced(tetMesh, skinMesh);
+        reduced.computeModes(30, 6);
+        double trainTime = measure([&]() { reduced.computeCubature(cachePath); }, 1);
+        PhysicalMeshf cached(tetMesh, skinMesh);
+        cached.computeModes(30, 6);
+        double loadTime = measure([&]() { cached.computeCubature(cachePath); }, 1);
+        for (PhysicalMeshf *pm : {&reduced, &cached}) {
+            pm->setIntegrator(Integrator::Modal);
+            pm->setTimeStep(1.0f/60);
+            pm->addObstacle(cubeField);
+        }
+        int iterations = 0;
+        double stepTime = measure([&]() {
+            reduced.simulationStep();
+            iterations += reduced.getSolverStats().iterations;
+        }, repeats);
+        for (int i = 0; i<repeats; i++) {
+            cached.simulationStep();
+        }
+        cubatureCached = cached.getModalTetCount() == reduced.getModalTetCount() &&
+                         cached.getCubatureError() == reduced.getCubatureError() &&
+                         cached.getPositions() == reduced.getPositions();
+        int tetCount = reduced.getTetCount();
+        Cubature corrupt;
+        corrupt.tets = {0, tetCount};
+        corrupt.weights = {1, 1};
+        corrupt.save(cachePath, 0);
+        cubatureCached = cubatureCached && !corrupt.load(cachePath, 0, tetCount) && corrupt.tets.empty();
+        std::remove(cachePath.c_str());
+        cout << "Cubature: " << reduced.getModalTetCount() << " of " << reduced.getTetCount() << " tets, error "
+             << reduced.getCubatureError() << ", trained in " << 1000*trainTime << " ms, loaded in " << 1000*loadTime
+             << " ms, step " << 1000*stepTime << " ms, " << (float)iterations/repeats << " Newton iterations" << endl;
+    }
+    
+    // Newton steps of the falling bunny with iterative linear solvers, iteration counts are per step.
+    LinearSolver solvers[] = {LinearSolver::MatrixFreeCG, LinearSolver::Multigrid, LinearSolver::MultigridCG};
+    const char *solverNames[] = {"matrix-free CG", "multigrid", "multigrid CG"};
+    for (int s = 0; s<3; s++) {
+        PhysicalMeshf iterative(tetMesh, skinMesh);
+        iterative.setIntegrator(Integrator::Newton);
+        iterative.setLinearSolver(solvers[s]);
+        // The bunny is small, coarse levels go down to a few dozen vertices so there is more than one.
+        iterative.setMultigridCoarsestSize(50);
+        iterative.setTimeStep(1.0f/60);
+        iterative.addObstacle(cubeField);
+        int steps = std::max(1, repeats/10);
+        int linearIterations = 0;
+        double stepTime = measure([&]() {
+            iterative.simulationStep();
+            linearIterations += iterative.getSolverStats().linearIterations;
+        }, steps);
+        cout << "Linear solver " << solverNames[s] << ": Newton step " << 1000*stepTime << " ms, "
+             << (float)linearIterations/steps << " linear iterations";
+        if (solvers[s] != LinearSolver::MatrixFreeCG) {
+            cout << ", levels";
+            for (int l = 0; l<iterative.getMultigrid().getLevelCount(); l++) {
+                cout << " " << iterative.getMultigrid().getLevelSize(l);
+            }
+        }
+        cout << endl;
+    }
+    
+    // Vertex orderings: force evaluation, implicit step time and the envelope of the stiffness matrix.
+    VertexOrdering orderings[] = {VertexOrdering::None, VertexOrdering::ReverseCuthillMcKee,
+                                  VertexOrdering::Morton, VertexOrdering::Hilbert};
+    for (VertexOrdering ordering : orderings) {
+        PhysicalMeshf ordered(tetMesh, skinMesh, MassMatrix::Consistent, ordering);
+        Eigen::VectorXf rest = ordered.getPositions();
+        ordered.setBatchedForces(false);
+        double forceTime = measure([&]() { ordered.dVdQ(rest); }, repeats);
+        long bandwidth, profile;
+        patternEnvelope(ordered.ddVddQ(rest), bandwidth, profile);
+        ordered.setIntegrator(Integrator::Newton);
+        ordered.setTimeStep(1.0f/60);
+        ordered.addObstacle(cubeField);
+        double stepTime = measure([&]() { ordered.simulationStep(); }, std::max(1, repeats/10));
+        cout << "Ordering " << vertexOrderingName(ordering) << ": dVdQ " << ordered.getTetCount()/forceTime << " tets/s, "
+             << "Newton step " << 1000*stepTime << " ms, bandwidth " << bandwidth << ", profile " << profile << endl;
+    }
+    
+    if (!kernelConsistent) {
+        cout << "Fused neo-hookean kernel doesn't match the generated functions" << endl;
+        return 1;
+    }
+    if (!cubatureCached) {
+        cout << "Cubature cache doesn't reproduce the trained cubature" << endl;
+        return 1;
+    }
+    if (freeFallContacts > 0) {
+        cout << "Self-collision finds contacts on a body in free fall" << endl;
+        return 1;
+    }
+    if (!consistent) {
+        cout << "Batched forces don't match the per-tetrahedron path" << endl;
+        return 1;
+    }
+    return 0;
+}
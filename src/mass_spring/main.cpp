@@ -3,9 +3,12 @@
 #include <iostream>
 #include "../utils/camera.h"
 #include "../utils/shader.h"
-#include "../utils/draw_shapes.h"
+#include "../utils/render_mesh.h"
+#include "../utils/vertex_normals.h"
 #include "../utils/RootDir.h"
 #include "physics.h"
+#include <fstream>
+#include <iomanip>
 
 #include <Eigen/Dense>
 
@@ -91,8 +94,17 @@ int main(int argc, const char * argv[]) {
         }
     }
     PhysicalMesh pm = PhysicalMesh(mesh, m, k, 1.0f, fixed_points);
+    VertexNormals meshNormals(mesh);
     
     float h = 0.005;
+    // Drags are recorded as an input script of the headless runner (src/physical_simulation) if a file is given.
+    std::ofstream record;
+    if (argc > 1) {
+        record.open(argv[1]);
+        // Enough digits to read back the same floats.
+        record << std::setprecision(9);
+    }
+    long frame = 0;
     while (!glfwWindowShouldClose(window))
     {
         float currentTime = (float)glfwGetTime();
@@ -110,15 +122,20 @@ int main(int argc, const char * argv[]) {
         Eigen::Matrix4f view = camera.GetViewMatrix();
         lightingShader.setMat4("view", view);
 
-        pm.moveFixedPoints(
-           Eigen::Vector3f(-mouseOffsetY*dragSensitivity,
-                           -mouseOffsetX*dragSensitivity,
-                           0));
+        Eigen::Vector3f drag(-mouseOffsetY*dragSensitivity,
+                             -mouseOffsetX*dragSensitivity,
+                             0);
+        pm.moveFixedPoints(drag);
+        if (record.is_open() && drag != Eigen::Vector3f::Zero()) {
+            record << frame << " drag " << drag[0] << " " << drag[1] << " " << drag[2] << "\n";
+        }
         
         pm.simulationStep(h);
+        frame++;
         
         //Updating original mesh with new positions.
         pm.updateMesh(mesh);
+        meshNormals.update(mesh);
         //Rendering original mesh.
         renderMesh(mesh, sphereVAO, sphereVBO);
         
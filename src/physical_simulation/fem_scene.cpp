@@ -0,0 +1,114 @@
+//
+//  fem_scene.cpp
+//  physical_simulation
+//
+//  Scene of the 3d_fem demo without rendering.
+//
+#include "scene.h"
+#include "../utils/RootDir.h"
+#include "../utils/vertex_normals.h"
+#include "../3d_fem/physics.h"
+
+using namespace std;
+
+namespace {
+
+// Cube under the bunny, displaced as in the demo.
+Mesh floorCube(const string &path_prefix) {
+    Mesh cubeMesh(path_prefix + "mesh/big_cube.obj");
+    for (auto &v : cubeMesh.positions) {
+        v += Eigen::Vector3f(0, -5.5f, 0);
+    }
+    return cubeMesh;
+}
+
+bool parseIntegrator(const string &name, Integrator &integrator) {
+    const pair<const char *, Integrator> names[] = {
+        {"verlet", Integrator::VelocityVerlet},
+        {"forward-euler", Integrator::ForwardEuler},
+        {"backward-euler", Integrator::BackwardEulerLinear},
+        {"newton", Integrator::Newton},
+        {"pd", Integrator::ProjectiveDynamics},
+        {"vbd", Integrator::VertexBlockDescent},
+        {"modal", Integrator::Modal}
+    };
+    for (const auto &entry : names) {
+        if (name == entry.first) {
+            integrator = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+class FemScene : public Scene {
+
+private:
+    string path_prefix = string(ROOT_DIR) + "src/3d_fem/";
+    TetrahedralMesh tetMesh;
+    Mesh skinMesh;
+    // Distance field of the cube, cached next to the mesh as in the demo.
+    SignedDistanceField cubeField;
+    PhysicalMeshf pm;
+    // Skin mesh buffer updated in place every step.
+    Mesh updatedMesh;
+    VertexNormals normals;
+    float frameTime = 1.0f/60;
+    int simulationPhase;
+    int skinningPhase;
+    int normalsPhase;
+
+public:
+    FemScene(Integrator integrator, const SceneOptions &options):
+        tetMesh(path_prefix + "mesh/bunny_tet.msh"),
+        skinMesh(path_prefix + "mesh/bunny.obj"),
+        cubeField(floorCube(path_prefix), 0.1f, path_prefix + "mesh/big_cube.sdf"),
+        pm(tetMesh, skinMesh, MassMatrix::Lumped) {
+        pm.setIntegrator(integrator);
+        pm.addObstacle(cubeField);
+        // Reduced steps over the modes and modal derivatives of the rest pose, with their cubature cached next to
+        // the tetrahedral mesh.
+        if (integrator == Integrator::Modal) {
+            pm.computeModes(30, 6);
+            pm.computeCubature(path_prefix + "mesh/bunny_tet.cubature");
+        }
+        if (options.threads > 0) {
+            pm.setThreadCount(options.threads);
+        }
+        if (options.timeStep > 0) {
+            frameTime = options.timeStep;
+        }
+        updatedMesh = pm.getSkinMesh();
+        normals = VertexNormals(updatedMesh);
+        simulationPhase = addPhase("simulation");
+        skinningPhase = addPhase("skinning");
+        normalsPhase = addPhase("normals");
+    }
+
+    // One demo frame: frameTime of simulated time in adaptive substeps, then the skin and its normals.
+    void step() override {
+        timed(simulationPhase, [&]() { pm.advance(frameTime); });
+        timed(skinningPhase, [&]() { pm.updateSkinPositions(updatedMesh.positions); });
+        timed(normalsPhase, [&]() { normals.update(updatedMesh); });
+    }
+
+    // The soft body has no vertices held in place.
+    bool drag(const Eigen::Vector3f &/*r*/) override {
+        return false;
+    }
+
+    const vector<Eigen::Vector3f> &getPositions() override {
+        return updatedMesh.positions;
+    }
+};
+
+}
+
+unique_ptr<Scene> createFemScene(const SceneOptions &options, string &error) {
+    Integrator integrator = Integrator::VelocityVerlet;
+    if (!options.integrator.empty() && !parseIntegrator(options.integrator, integrator)) {
+        error = "unknown integrator " + options.integrator + " of the fem scene";
+        return nullptr;
+    }
+    return unique_ptr<Scene>(new FemScene(integrator, options));
+}
@@ -0,0 +1,56 @@
+#ifndef input_script_h
+#define input_script_h
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Drag of the held vertices by r before step number step (counted from 0).
+struct InputEvent {
+    long step;
+    Eigen::Vector3f drag;
+};
+
+/**
+ * Recorded user input replayed by the headless runner, one event per line:
+ *   <step> drag <x> <y> <z>
+ * Empty lines and lines starting with # are skipped. Events are sorted by step, events of the same step
+ * keep their order. The mass_spring demo writes this format when started with a file name.
+ */
+inline bool loadInputScript(const std::string &path, std::vector<InputEvent> &events, std::string &error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "can't open input script " + path;
+        return false;
+    }
+    events.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream stream(line);
+        std::string kind;
+        InputEvent event;
+        if (!(stream >> event.step)) {
+            std::istringstream rest(line);
+            if (!(rest >> kind) || kind[0] == '#') {
+                continue;
+            }
+            error = path + ":" + std::to_string(lineNumber) + ": expected a step number";
+            return false;
+        }
+        if (!(stream >> kind) || kind != "drag"
+            || !(stream >> event.drag[0] >> event.drag[1] >> event.drag[2]) || event.step < 0) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected <step> drag <x> <y> <z>";
+            return false;
+        }
+        events.push_back(event);
+    }
+    std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) { return a.step < b.step; });
+    return true;
+}
+
+#endif /* input_script_h */
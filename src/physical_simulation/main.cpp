@@ -1,136 +1,127 @@
 //
 //  main.cpp
-//  mass_spring
+//  physical_simulation
 //
-//  Created by Grigory Oskin on 2021/01/04.
-//  Copyright © 2021 Grigory Oskin. All rights reserved.
+//  Headless batch runner: steps a demo scene as fast as possible, without glfw, glad or an OpenGL context.
 //
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <iostream>
-#include "../utils/camera.h"
-#include "../utils/shader.h"
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "scene.h"
+#include "input_script.h"
+
 #include <Eigen/Dense>
 
 using namespace std;
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow *window);
-
-// settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
-
-
-float deltaTime = 0.0f;    // Time between current frame and last frame
-float lastFrame = 0.0f; // Time of last frame
-
-void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void printUsage() {
+    cout << "Usage: physical_simulation [fem|mass_spring] [--steps N] [--script FILE] [--integrator NAME]"
+         << " [--threads N] [--dt SECONDS]" << endl
+         << "  fem integrators: verlet (default), forward-euler, backward-euler, newton, pd, vbd, modal" << endl;
+}
 
-Camera camera(Eigen::Vector3f(0.0f, 0.0f, 3.0f));
+// FNV-1a over the bytes of the positions, equal for bitwise equal runs.
+uint64_t positionsChecksum(const vector<Eigen::Vector3f> &positions) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto &p : positions) {
+        const unsigned char *bytes = (const unsigned char *)p.data();
+        for (size_t k = 0; k<3*sizeof(float); k++) {
+            hash = (hash ^ bytes[k])*1099511628211ull;
+        }
+    }
+    return hash;
+}
 
 int main(int argc, const char * argv[]) {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+    string sceneName = "fem";
+    string scriptPath;
+    long steps = 600;
+    SceneOptions options;
+    for (int i = 1; i<argc; i++) {
+        bool hasValue = i + 1<argc;
+        if (!strcmp(argv[i], "--steps") && hasValue) {
+            steps = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--script") && hasValue) {
+            scriptPath = argv[++i];
+        } else if (!strcmp(argv[i], "--integrator") && hasValue) {
+            options.integrator = argv[++i];
+        } else if (!strcmp(argv[i], "--threads") && hasValue) {
+            options.threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dt") && hasValue) {
+            options.timeStep = (float)atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            sceneName = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    vector<InputEvent> events;
+    string error;
+    if (!scriptPath.empty() && !loadInputScript(scriptPath, events, error)) {
+        cout << error << endl;
+        return 1;
     }
-    
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
 
-    while (!glfwWindowShouldClose(window))
-    {
-        float currentTime = (float)glfwGetTime();
-        deltaTime = currentTime - lastFrame;
-        lastFrame = currentTime;
-        
-        // input
-        // -----
-        processInput(window);
-        
-        // render
-        // -----
-        glClearColor(0.0f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    auto loadStart = chrono::steady_clock::now();
+    unique_ptr<Scene> scene;
+    if (sceneName == "fem") {
+        scene = createFemScene(options, error);
+    } else if (sceneName == "mass_spring") {
+        scene = createMassSpringScene(options, error);
+    } else {
+        error = "unknown scene " + sceneName;
     }
-    
-    glfwTerminate();
-    return 0;
-}
+    if (!scene) {
+        cout << error << endl;
+        printUsage();
+        return 1;
+    }
+    chrono::duration<double> loadTime = chrono::steady_clock::now() - loadStart;
 
-void processInput(GLFWwindow *window)
-{
-    Camera_Movement direction = Camera_Movement::NONE;
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-    
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        direction = Camera_Movement::FORWARD;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        direction = Camera_Movement::BACKWARD;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        direction = Camera_Movement::LEFT;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        direction = Camera_Movement::RIGHT;
-    
-    camera.ProcessKeyboard(direction, deltaTime);
-}
+    // Events are applied before their step, in the order of the script.
+    auto start = chrono::steady_clock::now();
+    size_t nextEvent = 0;
+    for (long s = 0; s<steps; s++) {
+        for (; nextEvent<events.size() && events[nextEvent].step == s; nextEvent++) {
+            if (!scene->drag(events[nextEvent].drag)) {
+                cout << "Scene " << sceneName << " rejected the drag event of step " << s << " in " << scriptPath
+                     << ", it has no vertices to drag" << endl;
+                return 1;
+            }
+        }
+        scene->step();
+    }
+    // Events of a step at or after the last one would otherwise be dropped without a word.
+    if (nextEvent<events.size()) {
+        cout << scriptPath << " has " << events.size() - nextEvent << " input events from step "
+             << events[nextEvent].step << " on, after the last of " << steps << " steps" << endl;
+        return 1;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
 
-float lastX = 400, lastY = 300;
-bool firstMouse = true;
-void mouse_callback(GLFWwindow* window, double xpos, double ypos){
-    if (firstMouse)
-    {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
+    cout << "Scene " << sceneName << ": loaded in " << 1000*loadTime.count() << " ms, " << steps << " steps in "
+         << elapsed.count() << " s, " << steps/elapsed.count() << " steps/s, " << nextEvent << " input events" << endl;
+    const vector<string> &names = scene->getPhaseNames();
+    const vector<double> &seconds = scene->getPhaseSeconds();
+    for (size_t p = 0; p<names.size(); p++) {
+        cout << "  " << names[p] << ": " << 1000*seconds[p]/max(steps, 1l) << " ms/step, "
+             << 100*seconds[p]/elapsed.count() << "%" << endl;
     }
-    
-    float xOffset = xpos - lastX;
-    float yOffset = ypos - lastY;
-    lastX = xpos;
-    lastY = ypos;
-    
-    float sensitivity = 0.1f;
-    xOffset *= sensitivity;
-    yOffset *= sensitivity;
-    
-    camera.ProcessMouseMovement(xOffset, yOffset);
-}
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
-{
-    // make sure the viewport matches the new window dimensions; note that width and
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    const vector<Eigen::Vector3f> &positions = scene->getPositions();
+    bool finite = true;
+    for (const auto &p : positions) {
+        finite = finite && p.allFinite();
+    }
+    cout << "Positions checksum: " << hex << setw(16) << setfill('0') << positionsChecksum(positions) << dec << endl;
+    if (!finite) {
+        cout << "Positions are not finite" << endl;
+        return 2;
+    }
+    return 0;
 }
@@ -0,0 +1,78 @@
+//
+//  mass_spring_scene.cpp
+//  physical_simulation
+//
+//  Scene of the mass_spring demo without rendering.
+//
+#include "scene.h"
+#include "../utils/RootDir.h"
+#include "../utils/vertex_normals.h"
+#include "../mass_spring/physics.h"
+
+using namespace std;
+
+namespace {
+
+// Vertices of the top of the bunny, which the demo drags with the mouse.
+vector<unsigned int> topVertices(const Mesh &mesh) {
+    vector<unsigned int> fixed_points;
+    for (auto index : mesh.indices) {
+        if (mesh.positions[index][1] > 0.7) {
+            fixed_points.push_back(index);
+        }
+    }
+    return fixed_points;
+}
+
+class MassSpringScene : public Scene {
+
+private:
+    Mesh mesh;
+    PhysicalMesh pm;
+    VertexNormals normals;
+    float h = 0.005f;
+    int inputPhase;
+    int simulationPhase;
+    int meshPhase;
+    int normalsPhase;
+
+public:
+    // Stiffness is proportional to the number of vertices as in the demo.
+    MassSpringScene(const SceneOptions &options):
+        mesh(string(ROOT_DIR) + "src/mass_spring/mesh/bunny.obj"),
+        pm(mesh, 1.0f, mesh.positions.size()*1.0f, 1.0f, topVertices(mesh)),
+        normals(mesh) {
+        if (options.timeStep > 0) {
+            h = options.timeStep;
+        }
+        inputPhase = addPhase("input");
+        simulationPhase = addPhase("simulation");
+        meshPhase = addPhase("mesh update");
+        normalsPhase = addPhase("normals");
+    }
+
+    void step() override {
+        timed(simulationPhase, [&]() { pm.simulationStep(h); });
+        timed(meshPhase, [&]() { pm.updateMesh(mesh); });
+        timed(normalsPhase, [&]() { normals.update(mesh); });
+    }
+
+    bool drag(const Eigen::Vector3f &r) override {
+        timed(inputPhase, [&]() { pm.moveFixedPoints(r); });
+        return true;
+    }
+
+    const vector<Eigen::Vector3f> &getPositions() override {
+        return mesh.positions;
+    }
+};
+
+}
+
+unique_ptr<Scene> createMassSpringScene(const SceneOptions &options, string &error) {
+    if (!options.integrator.empty()) {
+        error = "the mass_spring scene only has backward Euler";
+        return nullptr;
+    }
+    return unique_ptr<Scene>(new MassSpringScene(options));
+}
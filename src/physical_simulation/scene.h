@@ -0,0 +1,69 @@
+#ifndef scene_h
+#define scene_h
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Settings of a scene given on the command line, zero or empty values keep the demo setup.
+struct SceneOptions {
+    std::string integrator;
+    int threads = 0;
+    float timeStep = 0;
+};
+
+/**
+ * A simulation set up like one of the demos and stepped without a window or an OpenGL context.
+ * Every step does the work of one demo frame except rendering, split into named phases that are timed.
+ * Scenes are created in their own translation units, both simulations have a class named PhysicalMesh.
+ */
+class Scene {
+
+private:
+    std::vector<std::string> phaseNames;
+    std::vector<double> phaseSeconds;
+
+protected:
+    // Adds a phase with zero time and returns its index for timed.
+    int addPhase(const std::string &name) {
+        phaseNames.push_back(name);
+        phaseSeconds.push_back(0);
+        return (int)phaseNames.size() - 1;
+    }
+
+    // Runs f and adds its wall time to the phase.
+    template<typename Function>
+    void timed(int phase, Function f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        phaseSeconds[phase] += elapsed.count();
+    }
+
+public:
+    virtual ~Scene() = default;
+
+    virtual void step() = 0;
+    // Moves the vertices held by the user by r, returns false if the scene has none.
+    virtual bool drag(const Eigen::Vector3f &r) = 0;
+    // Vertices of the rendered mesh after the last step.
+    virtual const std::vector<Eigen::Vector3f> &getPositions() = 0;
+
+    // Time spent in every phase since the scene was created, in seconds.
+    const std::vector<std::string> &getPhaseNames() {
+        return phaseNames;
+    }
+
+    const std::vector<double> &getPhaseSeconds() {
+        return phaseSeconds;
+    }
+};
+
+// Soft bunny falling on a cube (src/3d_fem), returns nullptr and sets error for unknown options.
+std::unique_ptr<Scene> createFemScene(const SceneOptions &options, std::string &error);
+// Mass-spring bunny hanging by its top vertices (src/mass_spring).
+std::unique_ptr<Scene> createMassSpringScene(const SceneOptions &options, std::string &error);
+
+#endif /* scene_h */
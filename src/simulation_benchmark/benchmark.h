@@ -0,0 +1,42 @@
+#ifndef benchmark_h
+#define benchmark_h
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef COUNT_ALLOCATIONS
+// Defined by utils/alloc_counter.h, which only the fem cases include.
+long allocationCount();
+#endif
+
+// What one benchmark iteration processes, e.g. 3072 tets.
+struct Workload {
+    double amount = 1;
+    std::string unit;
+    // Number of tetrahedra or vertices of the mesh the case was set up with.
+    long meshSize = 0;
+    std::string meshUnit;
+};
+
+/**
+ * One parametrized benchmark. setup builds the state for a mesh resolution and a thread count, fills in the
+ * workload and returns the function that is timed, which keeps the state alive. Setup isn't timed.
+ */
+struct BenchmarkCase {
+    std::string name;
+    // Resolutions the case is run at, in the units of the case (cubes per side, sphere segments...).
+    std::vector<int> sizes;
+    // False for single threaded code, which is run with one thread only.
+    bool threaded = true;
+    std::function<std::function<void()>(int size, int threads, Workload &workload)> setup;
+};
+
+// Cases of src/3d_fem on blocks of cells^3 cubes split into tetrahedra, skinned with a sphere.
+void addFemCases(std::vector<BenchmarkCase> &cases, const std::vector<int> &cells);
+// Steps of src/mass_spring on spheres with the given numbers of segments.
+void addMassSpringCases(std::vector<BenchmarkCase> &cases, const std::vector<int> &segments);
+// Parsing of obj and msh files written from the generated meshes into directory, and of the bunny meshes.
+void addLoadingCases(std::vector<BenchmarkCase> &cases, const std::vector<int> &cells, const std::string &directory);
+
+#endif /* benchmark_h */
@@ -0,0 +1,157 @@
+//
+//  fem_cases.cpp
+//  simulation_benchmark
+//
+//  Benchmarks of src/3d_fem: potential and its derivatives, per-tetrahedron kernels, steps and skinning.
+//
+#include "benchmark.h"
+#include "test_meshes.h"
+#include "../3d_fem/physics.h"
+
+#include <memory>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+// Block of cells^3 cubes skinned with a sphere inside it, and a randomly deformed pose of it.
+struct FemState {
+    TetrahedralMesh tetMesh;
+    Mesh skinMesh;
+    PhysicalMeshf pm;
+    Eigen::VectorXf q;
+    // Obstacle of the step cases, the mesh keeps a pointer to it.
+    SignedDistanceField floor;
+
+    FemState(int cells, int threads):
+        tetMesh(blockTetMesh(cells)),
+        skinMesh(sphereTriangles(4*cells, 0.9f)),
+        pm(tetMesh, skinMesh) {
+        pm.setThreadCount(threads);
+        srand(0);
+        q = pm.getPositions() + 0.02f/cells*Eigen::VectorXf::Random(pm.getPositions().size());
+    }
+};
+
+void setTets(FemState &state, Workload &workload) {
+    workload.amount = state.pm.getTetCount();
+    workload.unit = "tets";
+    workload.meshSize = state.pm.getTetCount();
+    workload.meshUnit = "tets";
+}
+
+// Deformation gradients close to identity, one per tetrahedron of a block of cells^3 cubes.
+vector<Vector9<float>> deformationGradients(int cells) {
+    mt19937 random(0);
+    uniform_real_distribution<float> noise(-0.1f, 0.1f);
+    vector<Vector9<float>> gradients(6*cells*cells*cells);
+    for (auto &f : gradients) {
+        for (int k = 0; k<9; k++) {
+            f[k] = (k%4 == 0 ? 1 : 0) + noise(random);
+        }
+    }
+    return gradients;
+}
+
+// Step of the block with one integrator. It rests on a floor that touches its bottom face from the start, so
+// every iteration steps it in contact rather than in an ever faster fall.
+BenchmarkCase stepCase(const string &name, Integrator integrator, const vector<int> &cells) {
+    BenchmarkCase c;
+    c.name = name;
+    c.sizes = cells;
+    c.setup = [integrator](int size, int threads, Workload &workload) {
+        auto state = make_shared<FemState>(size, threads);
+        state->floor = SignedDistanceField(boxTriangles(Eigen::Vector3f(-3, -1.5f, -3), Eigen::Vector3f(3, -1, 3)), 0.25f);
+        state->pm.addObstacle(state->floor);
+        state->pm.setIntegrator(integrator);
+        setTets(*state, workload);
+        workload.amount = 1;
+        workload.unit = "steps";
+        return function<void()>([state]() { state->pm.simulationStep(); });
+    };
+    return c;
+}
+
+}
+
+void addFemCases(vector<BenchmarkCase> &cases, const vector<int> &cells) {
+    BenchmarkCase c;
+    c.sizes = cells;
+
+    c.name = "fem/dVdQ";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto state = make_shared<FemState>(size, threads);
+        setTets(*state, workload);
+        return function<void()>([state]() { state->pm.dVdQ(state->q); });
+    };
+    cases.push_back(c);
+
+    c.name = "fem/ddVddQ";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto state = make_shared<FemState>(size, threads);
+        setTets(*state, workload);
+        return function<void()>([state]() { state->pm.ddVddQ(state->q); });
+    };
+    cases.push_back(c);
+
+    c.name = "fem/V";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto state = make_shared<FemState>(size, threads);
+        setTets(*state, workload);
+        return function<void()>([state]() { state->pm.V(state->q); });
+    };
+    cases.push_back(c);
+
+    // Reference kernels of gradient.h and hessian.h, one deformation gradient per tetrahedron.
+    c.name = "fem/gradPsi";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto gradients = make_shared<vector<Vector9<float>>>(deformationGradients(size));
+        auto results = make_shared<vector<Vector9<float>>>(gradients->size());
+        workload.amount = workload.meshSize = gradients->size();
+        workload.unit = workload.meshUnit = "tets";
+        return function<void()>([gradients, results, threads]() {
+            long count = gradients->size();
+            #pragma omp parallel for num_threads(threads) schedule(static)
+            for (long i = 0; i<count; i++) {
+                (*results)[i] = gradPsi(170.0f, 169.5f, (*gradients)[i]);
+            }
+        });
+    };
+    cases.push_back(c);
+
+    c.name = "fem/psi_hessian";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto gradients = make_shared<vector<Vector9<float>>>(deformationGradients(size));
+        auto results = make_shared<AlignedVector<Matrix9<float>>>(gradients->size());
+        workload.amount = workload.meshSize = gradients->size();
+        workload.unit = workload.meshUnit = "tets";
+        return function<void()>([gradients, results, threads]() {
+            long count = gradients->size();
+            #pragma omp parallel for num_threads(threads) schedule(static)
+            for (long i = 0; i<count; i++) {
+                (*results)[i] = psi_hessian(170.0f, 169.5f, (*gradients)[i]);
+            }
+        });
+    };
+    cases.push_back(c);
+
+    // The three step functions of the original demo, and the fully implicit one.
+    cases.push_back(stepCase("fem/step/forward_euler", Integrator::ForwardEuler, cells));
+    cases.push_back(stepCase("fem/step/backward_euler_linear", Integrator::BackwardEulerLinear, cells));
+    cases.push_back(stepCase("fem/step/gradient_descent", Integrator::GradientDescent, cells));
+    cases.push_back(stepCase("fem/step/newton", Integrator::Newton, cells));
+
+    c.name = "fem/skinning";
+    c.setup = [](int size, int threads, Workload &workload) {
+        auto state = make_shared<FemState>(size, threads);
+        auto positions = make_shared<vector<Eigen::Vector3f>>();
+        state->pm.updateSkinPositions(*positions);
+        workload.amount = positions->size();
+        workload.unit = "vertices";
+        workload.meshSize = state->pm.getTetCount();
+        workload.meshUnit = "tets";
+        return function<void()>([state, positions]() { state->pm.updateSkinPositions(*positions); });
+    };
+    cases.push_back(c);
+}
@@ -0,0 +1,49 @@
+//
+//  loading_cases.cpp
+//  simulation_benchmark
+//
+//  Benchmarks of the obj and msh parsers of utils/draw_shapes.h.
+//
+#include "benchmark.h"
+#include "test_meshes.h"
+#include "../utils/RootDir.h"
+
+#include <memory>
+
+using namespace std;
+
+void addLoadingCases(vector<BenchmarkCase> &cases, const vector<int> &cells, const string &directory) {
+    // Size 0 is the bunny of the demos, other sizes are generated meshes written once at setup.
+    vector<int> sizes(1, 0);
+    sizes.insert(sizes.end(), cells.begin(), cells.end());
+    BenchmarkCase c;
+    c.sizes = sizes;
+    c.threaded = false;
+
+    c.name = "loading/msh";
+    c.setup = [directory](int size, int /*threads*/, Workload &workload) {
+        string path = string(ROOT_DIR) + "src/3d_fem/mesh/bunny_tet.msh";
+        if (size > 0) {
+            path = directory + "/block_" + to_string(size) + ".msh";
+            writeMsh(blockTetMesh(size), path);
+        }
+        workload.amount = workload.meshSize = TetrahedralMesh(path).indices.size()/4;
+        workload.unit = workload.meshUnit = "tets";
+        return function<void()>([path]() { TetrahedralMesh mesh(path); });
+    };
+    cases.push_back(c);
+
+    // Sphere with as many segments as the skin of the fem cases of the same size.
+    c.name = "loading/obj";
+    c.setup = [directory](int size, int /*threads*/, Workload &workload) {
+        string path = string(ROOT_DIR) + "src/3d_fem/mesh/bunny.obj";
+        if (size > 0) {
+            path = directory + "/sphere_" + to_string(size) + ".obj";
+            writeObj(sphereTriangles(4*size, 1.0f), path);
+        }
+        workload.amount = workload.meshSize = Mesh(path).positions.size();
+        workload.unit = workload.meshUnit = "vertices";
+        return function<void()>([path]() { Mesh mesh(path); });
+    };
+    cases.push_back(c);
+}
@@ -0,0 +1,262 @@
+//
+//  main.cpp
+//  simulation_benchmark
+//
+//  Parametrized benchmarks of the simulation pipeline over mesh resolutions and thread counts, results as JSON.
+//  Runs without a window.
+//
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "benchmark.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+struct BenchmarkResult {
+    string name;
+    int size;
+    int threads;
+    Workload workload;
+    long iterations;
+    double seconds;
+    double allocations;
+    long peakRssKb;
+};
+
+void printUsage() {
+    cerr << "Usage: simulation_benchmark [--filter TEXT] [--sizes A,B,...] [--segments A,B,...] [--threads A,B,...]"
+         << " [--min-time SECONDS] [--output FILE] [--mesh-dir DIR]" << endl;
+}
+
+vector<int> parseList(const string &text) {
+    vector<int> values;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        values.push_back(atoi(item.c_str()));
+    }
+    return values;
+}
+
+// Peak resident set size of the process so far. Every case runs in a process of its own, see runIsolated.
+long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// One warm-up call, then calls until minTime has passed. Setup and calls print nothing, the mesh
+// loaders and constructors log to cout.
+BenchmarkResult run(const BenchmarkCase &c, int size, int threads, double minTime) {
+    BenchmarkResult result;
+    result.name = c.name;
+    result.size = size;
+    result.threads = threads;
+    streambuf *output = cout.rdbuf(nullptr);
+    function<void()> iteration = c.setup(size, threads, result.workload);
+    iteration();
+#ifdef COUNT_ALLOCATIONS
+    long allocationsBefore = allocationCount();
+#endif
+    result.iterations = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double> elapsed(0);
+    while (elapsed.count()<minTime || result.iterations<3) {
+        iteration();
+        result.iterations++;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+    result.seconds = elapsed.count()/result.iterations;
+#ifdef COUNT_ALLOCATIONS
+    result.allocations = (double)(allocationCount() - allocationsBefore)/result.iterations;
+#else
+    result.allocations = -1;
+#endif
+    cout.rdbuf(output);
+    result.peakRssKb = peakRssKb();
+    return result;
+}
+
+// Runs the case in a child process, so the peak resident memory is the one of this case rather than the largest
+// of all cases so far, and a crashing case doesn't end the others. The child sends the result back through a pipe,
+// one field per line. Returns false if the child failed.
+bool runIsolated(const BenchmarkCase &c, int size, int threads, double minTime, BenchmarkResult &result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    // Buffered output would be written by both processes.
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        BenchmarkResult r = run(c, size, threads, minTime);
+        stringstream stream;
+        stream.precision(17);
+        stream << r.workload.amount << "\n" << r.workload.unit << "\n" << r.workload.meshSize << "\n"
+               << r.workload.meshUnit << "\n" << r.iterations << "\n" << r.seconds << "\n" << r.allocations << "\n"
+               << r.peakRssKb << "\n";
+        string text = stream.str();
+        bool written = write(fds[1], text.data(), text.size()) == (ssize_t)text.size();
+        _exit(written ? 0 : 1);
+    }
+    close(fds[1]);
+    string text;
+    char buffer[256];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, count);
+    }
+    close(fds[0]);
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return false;
+    }
+    result.name = c.name;
+    result.size = size;
+    result.threads = threads;
+    stringstream stream(text);
+    string line;
+    auto next = [&]() {
+        getline(stream, line);
+        return line;
+    };
+    result.workload.amount = atof(next().c_str());
+    result.workload.unit = next();
+    result.workload.meshSize = atol(next().c_str());
+    result.workload.meshUnit = next();
+    result.iterations = atol(next().c_str());
+    result.seconds = atof(next().c_str());
+    result.allocations = atof(next().c_str());
+    result.peakRssKb = atol(next().c_str());
+    return !stream.fail();
+}
+
+void writeJson(ostream &out, const vector<BenchmarkResult> &results, int hardwareThreads) {
+    out << "{\n  \"context\": {\"hardware_threads\": " << hardwareThreads
+#ifdef COUNT_ALLOCATIONS
+        << ", \"count_allocations\": true"
+#else
+        << ", \"count_allocations\": false"
+#endif
+        << "},\n  \"benchmarks\": [";
+    for (size_t i = 0; i<results.size(); i++) {
+        const BenchmarkResult &r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+            << ", \"mesh_size\": " << r.workload.meshSize << ", \"mesh_unit\": \"" << r.workload.meshUnit << "\""
+            << ", \"threads\": " << r.threads << ", \"iterations\": " << r.iterations
+            << ", \"seconds_per_iteration\": " << r.seconds
+            << ", \"throughput\": " << r.workload.amount/r.seconds << ", \"throughput_unit\": \"" << r.workload.unit << "/s\""
+            << ", \"allocations_per_iteration\": ";
+        // Allocations are only counted in builds with -DCOUNT_ALLOCATIONS=ON.
+        if (r.allocations < 0) {
+            out << "null";
+        } else {
+            out << r.allocations;
+        }
+        out << ", \"peak_rss_kb\": " << r.peakRssKb << "}";
+    }
+    out << "\n  ]\n}" << endl;
+}
+
+int main(int argc, const char * argv[]) {
+#ifdef _OPENMP
+    int hardwareThreads = omp_get_max_threads();
+#else
+    int hardwareThreads = 1;
+#endif
+    string filter;
+    string outputPath;
+    string meshDirectory = ".";
+    vector<int> cells = {4, 8, 12};
+    vector<int> segments = {16, 32, 48};
+    vector<int> threadCounts = {1};
+    if (hardwareThreads > 1) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    double minTime = 0.2;
+    for (int i = 1; i<argc; i++) {
+        if (i + 1 == argc) {
+            printUsage();
+            return 1;
+        }
+        if (!strcmp(argv[i], "--filter")) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--sizes")) {
+            cells = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--segments")) {
+            segments = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads")) {
+            threadCounts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--min-time")) {
+            minTime = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--output")) {
+            outputPath = argv[++i];
+        } else if (!strcmp(argv[i], "--mesh-dir")) {
+            meshDirectory = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    vector<BenchmarkCase> cases;
+    addFemCases(cases, cells);
+    addMassSpringCases(cases, segments);
+    addLoadingCases(cases, cells, meshDirectory);
+
+    // Progress goes to cerr, so JSON on cout can be piped.
+    vector<BenchmarkResult> results;
+    bool failed = false;
+    for (const BenchmarkCase &c : cases) {
+        if (c.name.find(filter) == string::npos) {
+            continue;
+        }
+        for (int size : c.sizes) {
+            for (int threads : threadCounts) {
+                if (!c.threaded && threads != threadCounts.front()) {
+                    continue;
+                }
+                int caseThreads = c.threaded ? threads : 1;
+                BenchmarkResult r;
+                if (!runIsolated(c, size, caseThreads, minTime, r)) {
+                    cerr << c.name << " size " << size << ", " << caseThreads << " threads: failed" << endl;
+                    failed = true;
+                    continue;
+                }
+                results.push_back(r);
+                cerr << r.name << " size " << size << " (" << r.workload.meshSize << " " << r.workload.meshUnit << "), "
+                     << caseThreads << " threads: " << 1000*r.seconds << " ms, "
+                     << r.workload.amount/r.seconds << " " << r.workload.unit << "/s" << endl;
+            }
+        }
+    }
+
+    if (outputPath.empty()) {
+        writeJson(cout, results, hardwareThreads);
+    } else {
+        ofstream file(outputPath);
+        writeJson(file, results, hardwareThreads);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+//
+//  mass_spring_cases.cpp
+//  simulation_benchmark
+//
+//  Benchmarks of src/mass_spring, in their own translation unit since both simulations have a PhysicalMesh.
+//
+#include "benchmark.h"
+#include "test_meshes.h"
+#include "../mass_spring/physics.h"
+
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+// Sphere hanging by its top vertices with the stiffness and time step of the demo.
+struct MassSpringState {
+    Mesh mesh;
+    PhysicalMesh pm;
+    float h = 0.005f;
+
+    static vector<unsigned int> topVertices(const Mesh &mesh) {
+        vector<unsigned int> fixed_points;
+        for (unsigned int i = 0; i<mesh.positions.size(); i++) {
+            if (mesh.positions[i][1] > 0.7) {
+                fixed_points.push_back(i);
+            }
+        }
+        return fixed_points;
+    }
+
+    MassSpringState(int segments):
+        mesh(sphereTriangles(segments, 1.0f)),
+        pm(mesh, 1.0f, mesh.positions.size()*1.0f, 1.0f, topVertices(mesh)) {}
+};
+
+}
+
+void addMassSpringCases(vector<BenchmarkCase> &cases, const vector<int> &segments) {
+    BenchmarkCase c;
+    c.name = "mass_spring/simulationStep";
+    c.sizes = segments;
+    // Steps are single threaded.
+    c.threaded = false;
+    c.setup = [](int size, int /*threads*/, Workload &workload) {
+        auto state = make_shared<MassSpringState>(size);
+        workload.amount = 1;
+        workload.unit = "steps";
+        workload.meshSize = state->mesh.positions.size();
+        workload.meshUnit = "vertices";
+        return function<void()>([state]() { state->pm.simulationStep(state->h); });
+    };
+    cases.push_back(c);
+}
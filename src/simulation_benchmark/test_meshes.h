@@ -0,0 +1,153 @@
+#ifndef test_meshes_h
+#define test_meshes_h
+
+#include "../utils/draw_shapes.h"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Meshes of any resolution for the benchmarks, the bunny meshes come in one size only.
+ */
+
+// Cube [-1, 1]^3 of cells^3 cubes, each split into 6 tetrahedra around its main diagonal.
+inline TetrahedralMesh blockTetMesh(int cells) {
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<unsigned int> indices;
+    int side = cells + 1;
+    float cellSize = 2.0f/cells;
+    for (int z = 0; z<side; z++) {
+        for (int y = 0; y<side; y++) {
+            for (int x = 0; x<side; x++) {
+                positions.push_back(Eigen::Vector3f(x, y, z)*cellSize - Eigen::Vector3f::Ones());
+            }
+        }
+    }
+    // Paths from corner 0 to corner 7 along the 3 axes in every order, each is a tetrahedron.
+    static const int axes[6][3] = {{1, 2, 4}, {1, 4, 2}, {2, 1, 4}, {2, 4, 1}, {4, 1, 2}, {4, 2, 1}};
+    auto vertex = [&](int x, int y, int z, int corner) {
+        return (unsigned int)(((z + (corner >> 2))*side + y + (corner >> 1 & 1))*side + x + (corner & 1));
+    };
+    for (int z = 0; z<cells; z++) {
+        for (int y = 0; y<cells; y++) {
+            for (int x = 0; x<cells; x++) {
+                for (const auto &path : axes) {
+                    int corner = 0;
+                    indices.push_back(vertex(x, y, z, corner));
+                    for (int step : path) {
+                        corner += step;
+                        indices.push_back(vertex(x, y, z, corner));
+                    }
+                }
+            }
+        }
+    }
+    return TetrahedralMesh(positions, indices);
+}
+
+// Triangle list of a sphere with the given radius, segments around and segments/2 from pole to pole.
+inline Mesh sphereTriangles(int segments, float radius) {
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector2f> uv;
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<unsigned int> indices;
+    const float PI = 3.14159265359f;
+    int rings = std::max(2, segments/2);
+    for (int y = 0; y<=rings; y++) {
+        for (int x = 0; x<segments; x++) {
+            float theta = PI*y/rings;
+            float phi = 2*PI*x/segments;
+            Eigen::Vector3f normal(std::cos(phi)*std::sin(theta), std::cos(theta), std::sin(phi)*std::sin(theta));
+            positions.push_back(radius*normal);
+            uv.push_back(Eigen::Vector2f((float)x/segments, (float)y/rings));
+            normals.push_back(normal);
+        }
+    }
+    for (int y = 0; y<rings; y++) {
+        for (int x = 0; x<segments; x++) {
+            unsigned int a = y*segments + x;
+            unsigned int b = y*segments + (x + 1)%segments;
+            unsigned int c = a + segments;
+            unsigned int d = b + segments;
+            // Triangles with two vertices at a pole have no area and are left out.
+            if (y > 0) {
+                indices.insert(indices.end(), {a, c, b});
+            }
+            if (y + 1<rings) {
+                indices.insert(indices.end(), {b, c, d});
+            }
+        }
+    }
+    return Mesh(positions, uv, normals, indices);
+}
+
+// Closed box between lower and upper, two outward facing triangles per side.
+inline Mesh boxTriangles(const Eigen::Vector3f &lower, const Eigen::Vector3f &upper) {
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector2f> uv;
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<unsigned int> indices;
+    // Bits 0, 1 and 2 of a corner select the upper coordinate along x, y and z.
+    for (int corner = 0; corner<8; corner++) {
+        positions.push_back(Eigen::Vector3f(corner & 1 ? upper[0] : lower[0], corner & 2 ? upper[1] : lower[1],
+                                            corner & 4 ? upper[2] : lower[2]));
+        uv.push_back(Eigen::Vector2f::Zero());
+        normals.push_back((positions.back() - (lower + upper)/2).normalized());
+    }
+    for (int axis = 0; axis<3; axis++) {
+        // The other two axes in the order whose cross product is +axis.
+        unsigned int u = 1 << (axis + 1)%3;
+        unsigned int v = 1 << (axis + 2)%3;
+        for (unsigned int side = 0; side<2; side++) {
+            unsigned int a = side << axis;
+            if (side) {
+                indices.insert(indices.end(), {a, a + u, a + u + v, a, a + u + v, a + v});
+            } else {
+                indices.insert(indices.end(), {a, a + u + v, a + u, a, a + v, a + u + v});
+            }
+        }
+    }
+    return Mesh(positions, uv, normals, indices);
+}
+
+// Writes the mesh in the msh layout TetrahedralMesh reads: coordinate lines of nodes and 1-based elements.
+inline void writeMsh(const TetrahedralMesh &mesh, const std::string &path) {
+    std::ofstream file(path);
+    long count = mesh.indices.size()/4;
+    file << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n$Nodes\n";
+    for (const auto &p : mesh.positions) {
+        file << p[0] << " " << p[1] << " " << p[2] << "\n";
+    }
+    file << "$EndNodes\n$Elements\n1 " << count << " 1 " << count << "\n3 0 4 " << count << "\n";
+    for (long i = 0; i<count; i++) {
+        file << i + 1;
+        for (int k = 0; k<4; k++) {
+            file << " " << mesh.indices[4*i + k] + 1;
+        }
+        file << "\n";
+    }
+    file << "$EndElements\n";
+}
+
+// Writes vertices, normals and faces of the mesh as obj, the loader scales positions by 0.7 when reading.
+inline void writeObj(const Mesh &mesh, const std::string &path) {
+    std::ofstream file(path);
+    for (const auto &p : mesh.positions) {
+        file << "v " << p[0] << " " << p[1] << " " << p[2] << "\n";
+    }
+    for (const auto &n : mesh.normals) {
+        file << "vn " << n[0] << " " << n[1] << " " << n[2] << "\n";
+    }
+    for (size_t i = 0; i<mesh.indices.size(); i += 3) {
+        file << "f";
+        for (int k = 0; k<3; k++) {
+            file << " " << mesh.indices[i + k] + 1 << "//" << mesh.indices[i + k] + 1;
+        }
+        file << "\n";
+    }
+}
+
+#endif /* test_meshes_h */
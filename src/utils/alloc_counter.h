@@ -0,0 +1,56 @@
+#ifndef alloc_counter_h
+#define alloc_counter_h
+
+/**
+ * Debug counter of heap allocations, enabled with cmake -DCOUNT_ALLOCATIONS=ON.
+ * Global operator new is replaced to count every allocation made through it (std containers, etc).
+ * Eigen allocates with malloc directly, so the same option defines EIGEN_RUNTIME_NO_MALLOC, Eigen allocations
+ * are counted by eigen_alloc_hook.h and code can forbid them with Eigen::internal::set_is_malloc_allowed(false),
+ * in release builds as well.
+ */
+#ifdef COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "eigen_alloc_hook.h"
+
+std::atomic<long> allocations(0);
+
+// Allocations through operator new and Eigen heap allocations.
+long allocationCount() {
+    return allocations.load() + alloc_hook::eigenAllocations().load();
+}
+
+void *operator new(std::size_t size) {
+    allocations++;
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
+
+#endif /* alloc_counter_h */
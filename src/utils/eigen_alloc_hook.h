@@ -0,0 +1,50 @@
+#ifndef eigen_alloc_hook_h
+#define eigen_alloc_hook_h
+
+/**
+ * Counter of Eigen heap allocations for COUNT_ALLOCATIONS builds, cmake includes it before every source file.
+ * With EIGEN_RUNTIME_NO_MALLOC every Eigen heap allocation checks eigen_assert(is_malloc_allowed() && "..."),
+ * which NDEBUG compiles out like every other assert. eigen_assert is replaced so that this check is kept in all
+ * build types: it counts the allocation and aborts if Eigen allocations are forbidden. The text of the assert is
+ * matched at compile time, other asserts stay Eigen's own and are still compiled out with NDEBUG.
+ */
+#ifdef COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+namespace alloc_hook {
+
+constexpr bool startsWith(const char *text, const char *prefix) {
+    return *prefix == 0 || (*text == *prefix && startsWith(text + 1, prefix + 1));
+}
+
+inline std::atomic<long> &eigenAllocations() {
+    static std::atomic<long> count(0);
+    return count;
+}
+
+inline void eigenAllocation(bool allowed) {
+    eigenAllocations()++;
+    if (!allowed) {
+        std::fprintf(stderr, "Eigen heap allocation while allocations are forbidden\n");
+        std::abort();
+    }
+}
+
+}
+
+#define eigen_assert(x) \
+    do { \
+        if (std::integral_constant<bool, alloc_hook::startsWith(#x, "is_malloc_allowed()")>::value) { \
+            alloc_hook::eigenAllocation(x); \
+        } else { \
+            eigen_plain_assert(x); \
+        } \
+    } while (false)
+
+#endif
+
+#endif /* eigen_alloc_hook_h */
@@ -0,0 +1,63 @@
+#ifndef render_mesh_h
+#define render_mesh_h
+
+#include "draw_shapes.h"
+
+/**
+ * OpenGL rendering of meshes, kept apart from draw_shapes.h so that headless targets don't need a GL context.
+ * Expects OpenGL functions (glad) to be included before.
+ */
+
+void renderMesh(Mesh &mesh, uint &vao, uint &vbo)
+{
+    unsigned int positions_size = mesh.positions.size() * sizeof(Eigen::Vector3f);
+    unsigned int normals_size = mesh.normals.size() * sizeof(Eigen::Vector3f);
+    unsigned int uv_size = mesh.uv.size() * sizeof(Eigen::Vector2f);
+    unsigned int total_size = positions_size + normals_size + uv_size;
+    
+    if (vao == 0)
+    {
+        glGenVertexArrays(1, &vao);
+
+        unsigned int ebo;
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, total_size,NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, positions_size, mesh.positions.data());
+        glBufferSubData(GL_ARRAY_BUFFER, positions_size, normals_size, mesh.normals.data());
+        glBufferSubData(GL_ARRAY_BUFFER, positions_size + normals_size, uv_size, mesh.uv.data());
+        
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(size_t)(positions_size));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(size_t)(positions_size + normals_size));
+    }
+    
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, positions_size, mesh.positions.data());
+    glBufferSubData(GL_ARRAY_BUFFER, positions_size, normals_size, mesh.normals.data());
+    
+    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// renders (and builds at first invocation) a sphere
+// -------------------------------------------------
+unsigned int sphereVAO = 0;
+unsigned int sphereVBO = 0;
+Mesh m;
+void renderSphere(unsigned int segments)
+{
+    m = sphereMesh(segments);
+   renderMesh(m, sphereVAO, sphereVBO);
+}
+#endif /* render_mesh_h */
@@ -0,0 +1,79 @@
+#ifndef vertex_normals_h
+#define vertex_normals_h
+
+#include "draw_shapes.h"
+#include <Eigen/Dense>
+#include <vector>
+
+/**
+ * Recomputes area weighted vertex normals of a deforming triangle mesh.
+ * Faces around every vertex are stored once as flat offsets and face lists, so every frame
+ * face normals are computed in one parallel loop and each vertex then sums its own faces.
+ * No two threads write to the same vertex, the result doesn't depend on the number of threads.
+ */
+class VertexNormals {
+
+private:
+    // Faces around vertex v are vertexFaces[vertexFaceOffsets[v]..vertexFaceOffsets[v + 1]).
+    std::vector<int> vertexFaceOffsets;
+    std::vector<int> vertexFaces;
+    // Cross products of face edges, their length is twice the face area.
+    std::vector<Eigen::Vector3f> faceNormals;
+
+public:
+    VertexNormals() = default;
+
+    // Adjacency of a triangle list mesh, the connectivity has to stay the same for later updates.
+    VertexNormals(const Mesh &mesh) {
+        int n = mesh.positions.size();
+        int n_faces = mesh.indices.size()/3;
+        vertexFaceOffsets.assign(n + 1, 0);
+        for (int f = 0; f<3*n_faces; f++) {
+            vertexFaceOffsets[mesh.indices[f] + 1]++;
+        }
+        for (int v = 0; v<n; v++) {
+            vertexFaceOffsets[v + 1] += vertexFaceOffsets[v];
+        }
+        vertexFaces.resize(3*n_faces);
+        std::vector<int> fill(vertexFaceOffsets.begin(), vertexFaceOffsets.end() - 1);
+        for (int f = 0; f<3*n_faces; f++) {
+            vertexFaces[fill[mesh.indices[f]]++] = f/3;
+        }
+        faceNormals.resize(n_faces);
+    }
+
+    // Overwrites mesh normals with normals of its current positions.
+    void update(Mesh &mesh) {
+        const std::vector<Eigen::Vector3f> &positions = mesh.positions;
+        const unsigned int *indices = mesh.indices.data();
+        int n = positions.size();
+        int n_faces = faceNormals.size();
+        if (mesh.normals.size() != n) {
+            mesh.normals.assign(n, Eigen::Vector3f::Zero());
+        }
+
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static)
+            for (int f = 0; f<n_faces; f++) {
+                const Eigen::Vector3f &a = positions[indices[3*f]];
+                faceNormals[f] = (positions[indices[3*f + 1]] - a).cross(positions[indices[3*f + 2]] - a);
+            }
+            // Gathering per vertex, faces are summed in a fixed order.
+            #pragma omp for schedule(static)
+            for (int v = 0; v<n; v++) {
+                Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+                for (int k = vertexFaceOffsets[v]; k<vertexFaceOffsets[v + 1]; k++) {
+                    normal += faceNormals[vertexFaces[k]];
+                }
+                float length = normal.norm();
+                // Isolated vertices and fully degenerate fans keep their previous normal.
+                if (length > 0) {
+                    mesh.normals[v] = normal/length;
+                }
+            }
+        }
+    }
+};
+
+#endif /* vertex_normals_h */